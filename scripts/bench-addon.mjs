@@ -0,0 +1,97 @@
+/**
+ * Compares the Linux helper process with the in-process N-API addon.
+ *
+ * Usage: node scripts/bench-addon.mjs [commands] [round-trips]
+ *
+ * Both run the headless backend, so neither needs a display or a session
+ * bus. Measures time to `ready`, the median getStats round trip, and the
+ * throughput of a stream of setTooltip commands. The addon hosts one core
+ * per process, so each variant runs once.
+ */
+
+import { spawn } from 'node:child_process';
+import { createInterface } from 'node:readline';
+import { createRequire } from 'node:module';
+import { existsSync } from 'node:fs';
+import { dirname, join } from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const require = createRequire(import.meta.url);
+const __dirname = dirname(fileURLToPath(import.meta.url));
+const binDir = join(__dirname, '..', 'binaries', `${process.platform}-${process.arch}`, 'bin');
+const commands = Number(process.argv[2] ?? 50000);
+const roundTrips = Number(process.argv[3] ?? 500);
+const args = ['--backend', 'headless'];
+
+// Both variants as { write(lines), next(method), close() }
+function helper() {
+  const proc = spawn(join(binDir, 'tray-sni'), args, { stdio: ['pipe', 'pipe', 'inherit'] });
+  const waiters = [];
+  createInterface({ input: proc.stdout }).on('line', line => dispatch(waiters, line));
+  return {
+    write: lines => proc.stdin.write(lines.join('')),
+    next: method => new Promise(resolve => waiters.push({ method, resolve })),
+    close: () => new Promise(resolve => { proc.once('close', resolve); proc.stdin.end(); }),
+  };
+}
+
+function addon() {
+  const core = require(join(binDir, 'trayjs.node'));
+  const waiters = [];
+  let closed;
+  core.start(args, line => line === null ? closed?.() : dispatch(waiters, line));
+  return {
+    write: lines => core.command(lines),
+    next: method => new Promise(resolve => waiters.push({ method, resolve })),
+    close: () => new Promise(resolve => { closed = resolve; core.stop(); }),
+  };
+}
+
+function dispatch(waiters, line) {
+  const msg = JSON.parse(line);
+  const i = waiters.findIndex(w => w.method === msg.method);
+  if (i >= 0) waiters.splice(i, 1)[0].resolve(msg.params);
+}
+
+const median = values => [...values].sort((a, b) => a - b)[values.length >> 1];
+const getStats = '{"method":"getStats"}\n';
+
+async function bench(start) {
+  const t0 = performance.now();
+  const tray = start();
+  await tray.next('ready');
+  const ready = performance.now() - t0;
+
+  const samples = [];
+  for (let i = 0; i < roundTrips; i++) {
+    const t = performance.now();
+    tray.write([getStats]);
+    await tray.next('stats');
+    samples.push(performance.now() - t);
+  }
+
+  const t1 = performance.now();
+  const lines = [];
+  for (let i = 0; i < commands; i++) {
+    lines.push(`{"method":"setTooltip","params":{"text":"tick ${i}"}}\n`);
+    if (lines.length === 1024) tray.write(lines.splice(0));
+  }
+  tray.write([...lines, getStats]);
+  const stats = await tray.next('stats');
+  const elapsed = performance.now() - t1;
+  await tray.close();
+  return { ready, roundTrip: median(samples), elapsed, stats };
+}
+
+for (const [name, file, start] of [['helper', 'tray-sni', helper], ['addon', 'trayjs.node', addon]]) {
+  if (!existsSync(join(binDir, file))) {
+    console.log(`${name}: missing ${file}`);
+    continue;
+  }
+  const { ready, roundTrip, elapsed, stats } = await bench(start);
+  console.log(`${name}:`);
+  console.log(`  ready           ${ready.toFixed(1)} ms`);
+  console.log(`  round trip      ${(roundTrip * 1000).toFixed(0)} µs (median of ${roundTrips})`);
+  console.log(`  throughput      ${(commands / elapsed * 1000).toFixed(0)} commands/s`);
+  console.log(`  parse           ${(stats.parseUs / stats.commands).toFixed(2)} µs/command`);
+}
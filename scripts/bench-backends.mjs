@@ -0,0 +1,77 @@
+/**
+ * Compares startup time and resident memory of the Linux tray binaries.
+ *
+ * Usage: node scripts/bench-backends.mjs [runs]
+ *
+ * Runs every binary in binaries/<platform>/bin against a private
+ * dbus-daemon, so the numbers neither depend on nor disturb the desktop
+ * session. The GTK build (`tray`) still needs a display (e.g. xvfb-run).
+ */
+
+import { spawn } from 'node:child_process';
+import { createInterface } from 'node:readline';
+import { existsSync, readFileSync } from 'node:fs';
+import { dirname, join } from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const __dirname = dirname(fileURLToPath(import.meta.url));
+const binDir = join(__dirname, '..', 'binaries', `${process.platform}-${process.arch}`, 'bin');
+const runs = Number(process.argv[2] ?? 10);
+
+function firstLine(stream) {
+  return new Promise((resolve, reject) => {
+    const rl = createInterface({ input: stream });
+    rl.once('line', line => { rl.close(); resolve(line); });
+    rl.once('close', () => reject(new Error('stream closed before first line')));
+  });
+}
+
+async function startBus() {
+  const daemon = spawn('dbus-daemon', ['--session', '--nofork', '--print-address=1'], {
+    stdio: ['ignore', 'pipe', 'inherit'],
+  });
+  const address = (await firstLine(daemon.stdout)).trim();
+  return { daemon, address };
+}
+
+function rssKb(pid) {
+  const m = readFileSync(`/proc/${pid}/status`, 'utf8').match(/VmRSS:\s+(\d+)/);
+  return m ? Number(m[1]) : NaN;
+}
+
+async function runOnce(bin, env) {
+  const t0 = performance.now();
+  const proc = spawn(bin, [], { stdio: ['pipe', 'pipe', 'inherit'], env });
+  const closed = new Promise(resolve => proc.once('close', resolve));
+  await firstLine(proc.stdout);
+  const ready = performance.now() - t0;
+  // Let watcher registration and the shell's initial queries settle.
+  await new Promise(resolve => setTimeout(resolve, 300));
+  const rss = rssKb(proc.pid);
+  proc.stdin.end();
+  await closed;
+  return { ready, rss };
+}
+
+const median = values => [...values].sort((a, b) => a - b)[values.length >> 1];
+
+const { daemon, address } = await startBus();
+const env = { ...process.env, DBUS_SESSION_BUS_ADDRESS: address };
+
+console.log(`${runs} runs each, private bus ${address}`);
+console.log('binary      ready (ms)   RSS (MB)');
+for (const name of ['tray', 'tray-sni']) {
+  const bin = join(binDir, name);
+  if (!existsSync(bin)) {
+    console.log(`${name.padEnd(12)}missing`);
+    continue;
+  }
+  const samples = [];
+  for (let i = 0; i < runs; i++)
+    samples.push(await runOnce(bin, env));
+  const ready = median(samples.map(s => s.ready));
+  const rss = median(samples.map(s => s.rss)) / 1024;
+  console.log(`${name.padEnd(12)}${ready.toFixed(1).padStart(10)}${rss.toFixed(1).padStart(11)}`);
+}
+
+daemon.kill();
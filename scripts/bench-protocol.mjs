@@ -0,0 +1,78 @@
+/**
+ * Measures command throughput of the Linux helper's protocol core.
+ *
+ * Usage: node scripts/bench-protocol.mjs [commands] [menu-items]
+ *
+ * Runs the helper with the headless backend, so it needs neither a display
+ * nor a session bus. Streams setMenu/setTooltip commands, where each menu
+ * differs from the previous one in a single item, then reads the helper's
+ * own counters with getStats.
+ */
+
+import { spawn } from 'node:child_process';
+import { createInterface } from 'node:readline';
+import { existsSync } from 'node:fs';
+import { dirname, join } from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const __dirname = dirname(fileURLToPath(import.meta.url));
+const binDir = join(__dirname, '..', 'binaries', `${process.platform}-${process.arch}`, 'bin');
+const commands = Number(process.argv[2] ?? 20000);
+const menuSize = Number(process.argv[3] ?? 50);
+
+function menu(tick) {
+  const items = [];
+  for (let i = 0; i < menuSize; i++)
+    items.push({ id: `item-${i}`, title: i === tick % menuSize ? `Item ${i} (${tick})` : `Item ${i}` });
+  items.push({ id: 'sep', separator: true });
+  items.push({ id: 'more', title: 'More', items: [{ id: 'quit', title: 'Quit' }] });
+  return items;
+}
+
+async function bench(bin) {
+  const proc = spawn(bin, ['--backend', 'headless'], { stdio: ['pipe', 'pipe', 'inherit'] });
+  const lines = createInterface({ input: proc.stdout });
+  const next = method => new Promise(resolve => {
+    const onLine = line => {
+      const msg = JSON.parse(line);
+      if (msg.method !== method) return;
+      lines.off('line', onLine);
+      resolve(msg.params);
+    };
+    lines.on('line', onLine);
+  });
+
+  await next('ready');
+  const t0 = performance.now();
+  let payload = '';
+  for (let i = 0; i < commands; i++) {
+    const msg = i % 2
+      ? { method: 'setTooltip', params: { text: `tick ${i}` } }
+      : { method: 'setMenu', params: { items: menu(i) } };
+    payload += JSON.stringify(msg) + '\n';
+    if (payload.length > 1 << 16) {
+      if (!proc.stdin.write(payload)) await new Promise(resolve => proc.stdin.once('drain', resolve));
+      payload = '';
+    }
+  }
+  proc.stdin.write(payload + JSON.stringify({ method: 'getStats' }) + '\n');
+  const stats = await next('stats');
+  const elapsed = performance.now() - t0;
+  proc.stdin.end();
+  return { elapsed, stats };
+}
+
+for (const name of ['tray', 'tray-sni']) {
+  const bin = join(binDir, name);
+  if (!existsSync(bin)) {
+    console.log(`${name}: missing`);
+    continue;
+  }
+  const { elapsed, stats } = await bench(bin);
+  const perCmd = us => (us / stats.commands).toFixed(2);
+  console.log(`${name}: ${commands} commands, ${menuSize + 3} menu items`);
+  console.log(`  throughput      ${(commands / elapsed * 1000).toFixed(0)} commands/s (${(stats.bytesIn / 1048576).toFixed(1)} MB)`);
+  console.log(`  parse           ${perCmd(stats.parseUs)} µs/command`);
+  console.log(`  dispatch        ${perCmd(stats.dispatchUs)} µs/command`);
+  console.log(`  menu updates    ${stats.menuUpdates}, item property changes ${stats.menuItemChanges}`);
+}
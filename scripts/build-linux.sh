@@ -12,9 +12,26 @@ SRC="$ROOT_DIR/src-linux"
 
 mkdir -p "$(dirname "$OUT")"
 
-CFLAGS=$(pkg-config --cflags gtk+-3.0 ayatana-appindicator3-0.1)
-LIBS=$(pkg-config --libs gtk+-3.0 ayatana-appindicator3-0.1)
+CFLAGS=$(pkg-config --cflags gtk+-3.0 ayatana-appindicator3-0.1 dbusmenu-glib-0.4)
+LIBS=$(pkg-config --libs gtk+-3.0 ayatana-appindicator3-0.1 dbusmenu-glib-0.4)
 
-gcc -O2 -Wall -o "$OUT" "$SRC/main.c" "$SRC/cJSON.c" $CFLAGS $LIBS -lpthread
+gcc -O2 -Wall -o "$OUT" "$SRC/main.c" "$SRC/protocol.c" "$SRC/appindicator.c" "$SRC/headless.c" "$SRC/cJSON.c" $CFLAGS $LIBS -lpthread -lm
 strip "$OUT"
 echo "Built $(wc -c < "$OUT" | tr -d ' ') bytes → $OUT"
+
+# GTK-free StatusNotifierItem backend
+OUT_SNI="$(dirname "$OUT")/tray-sni"
+SNI_CFLAGS=$(pkg-config --cflags gio-2.0 gdk-pixbuf-2.0 cairo)
+SNI_LIBS=$(pkg-config --libs gio-2.0 gdk-pixbuf-2.0 cairo)
+
+gcc -O2 -Wall -DTRAYJS_SNI -o "$OUT_SNI" "$SRC/main.c" "$SRC/protocol.c" "$SRC/sni.c" "$SRC/headless.c" "$SRC/cJSON.c" $SNI_CFLAGS $SNI_LIBS -lpthread -lm
+strip "$OUT_SNI"
+echo "Built $(wc -c < "$OUT_SNI" | tr -d ' ') bytes → $OUT_SNI"
+
+# In-process Node addon, same GTK-free core as tray-sni
+OUT_ADDON="$(dirname "$OUT")/trayjs.node"
+NODE_INCLUDE="${NODE_INCLUDE:-$(dirname "$(dirname "$(command -v node)")")/include/node}"
+
+gcc -O2 -Wall -shared -fPIC -fvisibility=hidden -DTRAYJS_SNI -DTRAYJS_ADDON -I"$NODE_INCLUDE" -o "$OUT_ADDON" "$SRC/addon.c" "$SRC/main.c" "$SRC/protocol.c" "$SRC/sni.c" "$SRC/headless.c" "$SRC/cJSON.c" $SNI_CFLAGS $SNI_LIBS -lpthread -lm
+strip --strip-unneeded "$OUT_ADDON"
+echo "Built $(wc -c < "$OUT_ADDON" | tr -d ' ') bytes → $OUT_ADDON"
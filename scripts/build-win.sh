@@ -39,7 +39,7 @@ fi
 # /W3: Enable standard warnings
 "$CL" /O2 /MT /DUNICODE /D_UNICODE /DCJSON_HIDE_SYMBOLS \
   /W3 \
-  "$SRC/main.c" "$SRC/cJSON.c" \
+  "$SRC/main.c" "$SRC/protocol.c" "$SRC/cJSON.c" \
   /Fe:"$OUT" \
   /link /SUBSYSTEM:WINDOWS /MACHINE:"$MACHINE" /OPT:REF /OPT:ICF \
   user32.lib shell32.lib gdi32.lib kernel32.lib advapi32.lib
@@ -0,0 +1,93 @@
+/**
+ * Checks that a destroyed tray leaves the StatusNotifierWatcher's list.
+ *
+ * Usage: node scripts/check-sni-watcher.mjs
+ *
+ * Runs binaries/<platform>/bin/tray-sni against a private dbus-daemon,
+ * adds tray 1, removes it again and then expects both its
+ * org.kde.StatusNotifierItem-<pid>-2 name and the connection that owned
+ * it to be gone: watchers drop an item when the owner of the name it
+ * registered with leaves the bus. Needs `gdbus` on the PATH.
+ */
+
+import { execFileSync, spawn } from 'node:child_process';
+import { createInterface } from 'node:readline';
+import { existsSync } from 'node:fs';
+import { dirname, join } from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const __dirname = dirname(fileURLToPath(import.meta.url));
+const bin = join(__dirname, '..', 'binaries', `${process.platform}-${process.arch}`, 'bin', 'tray-sni');
+
+function firstLine(stream) {
+  return new Promise((resolve, reject) => {
+    const rl = createInterface({ input: stream });
+    rl.once('line', line => { rl.close(); resolve(line); });
+    rl.once('close', () => reject(new Error('stream closed before first line')));
+  });
+}
+
+async function startBus() {
+  const daemon = spawn('dbus-daemon', ['--session', '--nofork', '--print-address=1'], {
+    stdio: ['ignore', 'pipe', 'inherit'],
+  });
+  const address = (await firstLine(daemon.stdout)).trim();
+  return { daemon, address };
+}
+
+function busCall(env, method, ...args) {
+  return execFileSync('gdbus', ['call', '--session', '--dest', 'org.freedesktop.DBus',
+    '--object-path', '/org/freedesktop/DBus', '--method', `org.freedesktop.DBus.${method}`, ...args],
+    { env, encoding: 'utf8' });
+}
+
+const listNames = env => busCall(env, 'ListNames');
+
+async function waitFor(what, test, ms = 2000) {
+  for (const deadline = Date.now() + ms; Date.now() < deadline;) {
+    if (test()) return;
+    await new Promise(resolve => setTimeout(resolve, 50));
+  }
+  throw new Error(`timed out waiting for ${what}`);
+}
+
+if (!existsSync(bin)) {
+  console.error(`${bin} is missing; run scripts/build-linux.sh first`);
+  process.exit(1);
+}
+
+const { daemon, address } = await startBus();
+const env = { ...process.env, DBUS_SESSION_BUS_ADDRESS: address };
+const proc = spawn(bin, [], { stdio: ['pipe', 'pipe', 'inherit'], env });
+const events = [];
+createInterface({ input: proc.stdout }).on('line', line => events.push(JSON.parse(line)));
+const send = msg => proc.stdin.write(JSON.stringify(msg) + '\n');
+const seen = (method, tray) => () => events.some(e => e.method === method && e.tray === tray);
+
+let failed = false;
+try {
+  await waitFor('tray 0', () => events.some(e => e.method === 'ready'));
+  send({ method: 'createTray', params: { id: 1 } });
+  await waitFor('tray 1', seen('ready', 1));
+
+  const name = `org.kde.StatusNotifierItem-${proc.pid}-2`;
+  await waitFor(`${name} on the bus`, () => listNames(env).includes(`'${name}'`));
+  const owner = busCall(env, 'GetNameOwner', name).match(/'([^']+)'/)[1];
+
+  send({ method: 'destroyTray', params: { id: 1 } });
+  await waitFor('tray 1 to close', seen('closed', 1));
+  await waitFor(`${name} and ${owner} to leave the bus`, () => {
+    const names = listNames(env);
+    return !names.includes(`'${name}'`) && !names.includes(`'${owner}'`);
+  });
+  await waitFor('tray 0 to stay listed', () => listNames(env).includes(`-${proc.pid}-1'`));
+  console.log(`ok: ${name} (${owner}) left the bus after destroyTray`);
+} catch (err) {
+  console.error(`FAIL: ${err.message}`);
+  failed = true;
+}
+
+proc.stdin.end();
+await new Promise(resolve => proc.once('close', resolve));
+daemon.kill();
+process.exit(failed ? 1 : 0);
@@ -41,8 +41,9 @@ done
 
 # Make Unix binaries executable.
 for pkg in "${PACKAGES[@]}"; do
-  bin="binaries/$pkg/bin/tray"
-  [[ -f "$bin" ]] && chmod +x "$bin"
+  for bin in "binaries/$pkg/bin/tray" "binaries/$pkg/bin/tray-sni"; do
+    [[ -f "$bin" ]] && chmod +x "$bin"
+  done
 done
 
 echo "Done. Binaries placed in binaries/*/bin/"
@@ -0,0 +1,315 @@
+/**
+ * Generates the helper protocol bindings from protocol/protocol.json.
+ *
+ * Usage: node scripts/gen-protocol.mjs [--check]
+ *
+ * Writes src/protocol.ts (typed command encoders, event decoder) and
+ * protocol.h/protocol.c into every C helper directory (command decoder and
+ * dispatch). With --check nothing is written; the script fails if any
+ * generated file is out of date.
+ *
+ * Field types are string, int, number, bool and json; a trailing `?` marks
+ * the field optional. A field given as an object may add `ts` (the
+ * TypeScript type), `preEncoded` (json the encoder takes as JSON text) and
+ * `doc`. Envelope fields sit next to `method` and `params` in every line.
+ * Commands with the same `slot` replace each other's part of what a tray
+ * shows; a daemon reports the lineDigest of the last line in each slot.
+ */
+
+import { readFileSync, writeFileSync, existsSync } from 'node:fs';
+import { dirname, join } from 'node:path';
+import { fileURLToPath } from 'node:url';
+
+const __dirname = dirname(fileURLToPath(import.meta.url));
+const root = join(__dirname, '..');
+const schema = JSON.parse(readFileSync(join(root, 'protocol', 'protocol.json'), 'utf8'));
+const C_DIRS = ['src-linux', 'src-win'];
+const BANNER = 'Generated by scripts/gen-protocol.mjs from protocol/protocol.json. Do not edit.';
+
+const TS_TYPES = { string: 'string', int: 'number', number: 'number', bool: 'boolean', json: 'unknown' };
+
+function field(name, spec) {
+  if (typeof spec === 'string') spec = { type: spec };
+  const optional = spec.type.endsWith('?');
+  const type = optional ? spec.type.slice(0, -1) : spec.type;
+  if (!(type in TS_TYPES)) throw new Error(`${name}: unknown type ${spec.type}`);
+  return { name, type, optional, ts: spec.ts ?? TS_TYPES[type], preEncoded: !!spec.preEncoded, doc: spec.doc };
+}
+
+function messages(group) {
+  return Object.entries(group).map(([name, { doc, slot, params }]) => ({
+    name,
+    doc,
+    slot,
+    // `params` is either a field map or one opaque json value
+    opaque: params && typeof params.type === 'string' ? field('params', params) : null,
+    fields: params && typeof params.type !== 'string'
+      ? Object.entries(params).map(([k, v]) => field(k, v)) : [],
+  }));
+}
+
+const envelope = Object.entries(schema.envelope ?? {}).map(([k, v]) => field(k, v));
+const commands = messages(schema.commands);
+const events = messages(schema.events);
+const slots = [...new Set(commands.filter(c => c.slot).map(c => c.slot))];
+
+const upperSnake = s => s.replace(/([a-z0-9])([A-Z])/g, '$1_$2').toUpperCase();
+const capitalize = s => s[0].toUpperCase() + s.slice(1);
+const tsDoc = (doc, indent) => doc ? `${indent}/** ${doc.replace(/\|(\w+)\|/g, '`$1`')} */\n` : '';
+const tsFields = (fields, encoded) => fields.length
+  ? `{ ${fields.map(f => `${f.name}${f.optional ? '?' : ''}: ${encoded && f.preEncoded ? 'string' : f.ts}${f.optional ? ' | null' : ''}`).join('; ')} }`
+  : 'void';
+
+/* -----------------------------------------------------------------------
+ * TypeScript
+ * ----------------------------------------------------------------------- */
+function genTs() {
+  const imports = Object.entries(schema.tsImports ?? {})
+    .map(([from, names]) => `import type { ${names.join(', ')} } from '${from}';\n`).join('');
+  let out = `// ${BANNER}\n\n${imports}\nexport const PROTOCOL_VERSION = ${schema.version};\n\n`;
+
+  out += '/** Parameters of the commands Node sends to the helper. */\nexport interface Commands {\n';
+  for (const c of commands) out += `${tsDoc(c.doc, '  ')}  ${c.name}: ${tsFields(c.fields, false)};\n`;
+  out += '}\n\n';
+
+  out += '/** Parameters of the events the helper sends to Node. */\nexport interface Events {\n';
+  for (const e of events) out += `${tsDoc(e.doc, '  ')}  ${e.name}: ${e.opaque ? e.opaque.ts : tsFields(e.fields, false)};\n`;
+  out += '}\n\n';
+
+  out += '/** Fields next to `method` and `params`. */\nexport interface Envelope {\n';
+  for (const f of envelope) out += `${tsDoc(f.doc, '  ')}  ${f.name}?: ${f.ts};\n`;
+  out += '}\n\n';
+
+  out += 'export type Event = {\n  [M in keyof Events]: { method: M; params: Events[M] } & Envelope;\n}[keyof Events];\n\n';
+
+  // Encoders concatenate the line directly; optional fields that are null or
+  // undefined are left out, which the helpers treat as absent.
+  out += '/** One encoder per command, each returning a complete protocol line. */\nexport const encode = {\n';
+  for (const c of commands) {
+    const head = `'{"method":"${c.name}"`;
+    if (!c.fields.length) {
+      out += `  ${c.name}: (): string => ${head}}\\n',\n`;
+      continue;
+    }
+    out += `  ${c.name}(p: ${tsFields(c.fields, true)}): string {\n    let s = '';\n`;
+    for (const f of c.fields) {
+      const value = f.preEncoded ? `p.${f.name}` : `JSON.stringify(p.${f.name})`;
+      const append = `s += ',"${f.name}":' + ${value};`;
+      out += f.optional ? `    if (p.${f.name} != null) ${append}\n` : `    ${append}\n`;
+    }
+    out += `    return ${head},"params":{' + s.slice(1) + '}}\\n';\n  },\n`;
+  }
+  out += '};\n\n';
+
+  out += '/** Adds envelope fields to a line from `encode`. */\n';
+  out += 'export function withEnvelope(line: string, env: Envelope): string {\n  let s = \'\';\n';
+  for (const f of envelope)
+    out += `  if (env.${f.name} != null) s += '"${f.name}":' + JSON.stringify(env.${f.name}) + ',';\n`;
+  out += '  return s ? \'{\' + s + line.slice(1) : line;\n}\n\n';
+
+  out += '/** The state slot each command line replaces. */\n';
+  out += 'export const STATE_SLOTS: { readonly [M in keyof Commands]?: string } = {\n';
+  for (const c of commands.filter(c => c.slot)) out += `  ${c.name}: '${c.slot}',\n`;
+  out += '};\n\n';
+
+  // FNV-1a over the UTF-8 bytes; proto_line_digest in C must agree
+  out += '/** Digest of a line from `encode`, as daemons report it in `ready`. */\n';
+  out += 'export function lineDigest(line: string): string {\n';
+  out += '  let h = 0x811c9dc5;\n';
+  out += '  for (const b of Buffer.from(line.endsWith(\'\\n\') ? line.slice(0, -1) : line))\n';
+  out += '    h = Math.imul(h ^ b, 0x01000193);\n';
+  out += '  return (h >>> 0).toString(16).padStart(8, \'0\');\n}\n\n';
+
+  out += `const EVENTS = new Set<string>([${events.map(e => `'${e.name}'`).join(', ')}]);\n\n`;
+  out += '/** Parses a helper line; undefined for events this version does not know. */\n';
+  out += 'export function decodeEvent(line: string): Event | undefined {\n';
+  out += '  const msg = JSON.parse(line);\n';
+  out += '  if (!msg || typeof msg.method !== \'string\' || !EVENTS.has(msg.method)) return undefined;\n';
+  out += `  return { method: msg.method, params: msg.params ?? {}${envelope.map(f => `, ${f.name}: msg.${f.name} ?? undefined`).join('')} } as Event;\n`;
+  out += '}\n';
+  return out;
+}
+
+/* -----------------------------------------------------------------------
+ * C
+ * ----------------------------------------------------------------------- */
+const C_TYPES = { string: 'const char *', int: 'int', number: 'double', bool: 'int', json: 'cJSON *' };
+const hasFlag = f => (f.type === 'int' || f.type === 'number') && `has${capitalize(f.name)}`;
+const structName = c => `Proto${capitalize(c.name)}`;
+const enumName = c => `PROTO_CMD_${upperSnake(c.name)}`;
+const cDoc = doc => doc ? `/* ${doc} */\n` : '';
+
+function genHeader() {
+  let out = `/*\n * ${BANNER}\n *\n`;
+  out += ' * Command decoder for the JSON-lines protocol.  Decoding walks each parsed\n';
+  out += ' * message once and allocates nothing: strings and json fields point into\n';
+  out += ' * the cJSON tree and stay valid until it is deleted.  Absent or mistyped\n';
+  out += ' * fields decode as NULL / 0 with their has-flag cleared.\n */\n\n';
+  out += '#ifndef TRAYJS_PROTOCOL_H\n#define TRAYJS_PROTOCOL_H\n\n#include <stddef.h>\n#include <stdint.h>\n\n#include "cJSON.h"\n\n';
+  out += `#define TRAYJS_PROTOCOL_VERSION ${schema.version}\n\n`;
+
+  out += 'typedef enum {\n    PROTO_CMD_UNKNOWN = -1,\n';
+  for (const c of commands) out += `    ${enumName(c)},\n`;
+  out += '    PROTO_CMD_COUNT\n} ProtoCommand;\n\n';
+
+  out += '/* Part of what a tray shows; the commands of a slot replace each other */\n';
+  out += 'typedef enum {\n    PROTO_SLOT_NONE,\n';
+  for (const slot of slots) out += `    PROTO_SLOT_${upperSnake(slot)},\n`;
+  out += '    PROTO_SLOT_COUNT\n} ProtoSlot;\n\n';
+
+  const struct = (doc, fields, name) => {
+    let s = cDoc(doc) + 'typedef struct {\n';
+    for (const f of fields) {
+      s += `    ${C_TYPES[f.type]}${C_TYPES[f.type].endsWith('*') ? '' : ' '}${f.name};\n`;
+      if (hasFlag(f)) s += `    int ${hasFlag(f)};\n`;
+    }
+    return s + `} ${name};\n\n`;
+  };
+  out += struct('Fields next to method and params', envelope, 'ProtoEnvelope');
+  for (const c of commands.filter(c => c.fields.length)) out += struct(c.doc, c.fields, structName(c));
+
+  out += '/* One handler per command, called with the |ctx| given to proto_dispatch;\n';
+  out += '   NULL handlers are ignored like unknown methods */\ntypedef struct {\n';
+  for (const c of commands)
+    out += `    void (*${c.name})(void *ctx${c.fields.length ? `, const ${structName(c)} *p` : ''});\n`;
+  out += '} ProtoHandlers;\n\n';
+
+  out += '/* Method name to command, PROTO_CMD_UNKNOWN if there is none */\n';
+  out += 'ProtoCommand proto_command(const char *name, size_t len);\n\n';
+  out += '/* Slot whose shown state |cmd| replaces, and its name in ready\'s state */\n';
+  out += 'ProtoSlot   proto_command_slot(ProtoCommand cmd);\n';
+  out += 'const char *proto_slot_name(ProtoSlot slot);\n\n';
+  out += '/* FNV-1a of a command line without its envelope fields, as lineDigest()\n';
+  out += '   computes it for the line before they were added */\n';
+  out += 'uint32_t proto_line_digest(const char *line, size_t len);\n\n';
+  out += '/* Decodes the envelope fields of |msg| */\n';
+  out += 'void proto_envelope(const cJSON *msg, ProtoEnvelope *out);\n\n';
+  out += '/* Decodes |msg| ({method, params}) and calls its handler.  Returns the\n';
+  out += '   command, or PROTO_CMD_UNKNOWN when nothing was called. */\n';
+  out += 'ProtoCommand proto_dispatch(const cJSON *msg, const ProtoHandlers *handlers, void *ctx);\n\n';
+  out += '#endif\n';
+  return out;
+}
+
+// switch (len) { case N: memcmp each candidate } over |names|; |onMatch(i)|
+// returns the extra condition and the statement for a match.
+function genMatch(names, subject, indent, onMatch) {
+  const byLen = new Map();
+  names.forEach((name, i) => byLen.set(name.length, [...(byLen.get(name.length) ?? []), [name, i]]));
+  let out = `${indent}switch (len) {\n`;
+  for (const [len, group] of [...byLen].sort((a, b) => a[0] - b[0])) {
+    out += `${indent}case ${len}:\n`;
+    for (const [name, i] of group) {
+      const [cond, stmt] = onMatch(i);
+      out += `${indent}    if (!memcmp(${subject}, "${name}", ${len})${cond}) ${stmt}\n`;
+    }
+    out += `${indent}    break;\n`;
+  }
+  return out + `${indent}}\n`;
+}
+
+// Extra match condition and assignment for one field
+function genDecodeField(f) {
+  const to = `out->${f.name}`;
+  switch (f.type) {
+  case 'string': return [' && cJSON_IsString(c)', `${to} = c->valuestring;`];
+  case 'int': return [' && cJSON_IsNumber(c)', `{ ${to} = c->valueint; out->${hasFlag(f)} = 1; }`];
+  case 'number': return [' && cJSON_IsNumber(c)', `{ ${to} = c->valuedouble; out->${hasFlag(f)} = 1; }`];
+  case 'bool': return ['', `${to} = cJSON_IsTrue(c);`];
+  case 'json': return ['', `${to} = (cJSON *)c;`];
+  }
+}
+
+function genSource() {
+  let out = `/*\n * ${BANNER}\n */\n\n#include <string.h>\n\n#include "protocol.h"\n\n`;
+
+  out += 'ProtoCommand proto_command(const char *name, size_t len) {\n';
+  out += genMatch(commands.map(c => c.name), 'name', '    ', i => ['', `return ${enumName(commands[i])};`]);
+  out += '    return PROTO_CMD_UNKNOWN;\n}\n\n';
+
+  out += 'ProtoSlot proto_command_slot(ProtoCommand cmd) {\n    switch (cmd) {\n';
+  for (const c of commands.filter(c => c.slot))
+    out += `    case ${enumName(c)}: return PROTO_SLOT_${upperSnake(c.slot)};\n`;
+  out += '    default: return PROTO_SLOT_NONE;\n    }\n}\n\n';
+
+  out += 'const char *proto_slot_name(ProtoSlot slot) {\n    static const char *const names[] = {\n';
+  for (const slot of slots) out += `        [PROTO_SLOT_${upperSnake(slot)}] = "${slot}",\n`;
+  out += '    };\n    return slot > PROTO_SLOT_NONE && slot < PROTO_SLOT_COUNT ? names[slot] : NULL;\n}\n\n';
+
+  // withEnvelope puts the (integer) envelope fields first, each up to a comma
+  out += 'uint32_t proto_line_digest(const char *line, size_t len) {\n';
+  out += '    size_t i = len ? 1 : 0;\n';
+  for (const f of envelope) {
+    const key = `"\\"${f.name}\\":"`, n = f.name.length + 3;
+    out += `    if (len - i > ${n} && !memcmp(line + i, ${key}, ${n})) {\n`;
+    out += '        const char *comma = memchr(line + i, \',\', len - i);\n';
+    out += '        if (comma) i = comma - line + 1;\n    }\n';
+  }
+  out += '    uint32_t h = 2166136261u;\n';
+  out += '    if (len) h = (h ^ (unsigned char)line[0]) * 16777619u;\n';
+  out += '    for (; i < len; i++) h = (h ^ (unsigned char)line[i]) * 16777619u;\n';
+  out += '    return h;\n}\n\n';
+
+  // |msg| may be any JSON value; params is known to be an object
+  const decoder = (head, from, fields) => {
+    const cond = from === 'msg' ? 'c && c->string' : 'c';
+    let s = `${head} {\n    for (const cJSON *c = ${from}->child; ${cond}; c = c->next) {\n`;
+    s += '        size_t len = strlen(c->string);\n';
+    s += genMatch(fields.map(f => f.name), 'c->string', '        ', i => genDecodeField(fields[i]));
+    return s + '    }\n}\n\n';
+  };
+  out += decoder('void proto_envelope(const cJSON *msg, ProtoEnvelope *out)', 'msg', envelope);
+  for (const c of commands.filter(c => c.fields.length))
+    out += decoder(`static void decode${capitalize(c.name)}(const cJSON *params, ${structName(c)} *out)`, 'params', c.fields);
+
+  out += 'ProtoCommand proto_dispatch(const cJSON *msg, const ProtoHandlers *handlers, void *ctx) {\n';
+  out += '    const cJSON *method = NULL, *params = NULL;\n';
+  out += '    for (const cJSON *c = msg->child; c && c->string; c = c->next) {\n';
+  out += '        if (!strcmp(c->string, "method")) method = c;\n';
+  out += '        else if (!strcmp(c->string, "params")) params = c;\n';
+  out += '    }\n';
+  out += '    if (!cJSON_IsString(method)) return PROTO_CMD_UNKNOWN;\n';
+  out += '    static const cJSON noParams;\n';
+  out += '    if (!cJSON_IsObject(params)) params = &noParams;\n\n';
+  out += '    ProtoCommand cmd = proto_command(method->valuestring, strlen(method->valuestring));\n';
+  out += '    switch (cmd) {\n';
+  for (const c of commands) {
+    out += `    case ${enumName(c)}:\n`;
+    out += `        if (!handlers->${c.name}) break;\n`;
+    if (c.fields.length) {
+      out += `        {\n            ${structName(c)} p = {0};\n`;
+      out += `            decode${capitalize(c.name)}(params, &p);\n`;
+      out += `            handlers->${c.name}(ctx, &p);\n        }\n`;
+    } else {
+      out += `        handlers->${c.name}(ctx);\n`;
+    }
+    out += '        return cmd;\n';
+  }
+  out += '    default:\n        break;\n    }\n    return PROTO_CMD_UNKNOWN;\n}\n';
+  return out;
+}
+
+/* -----------------------------------------------------------------------
+ * Output
+ * ----------------------------------------------------------------------- */
+const outputs = { [join('src', 'protocol.ts')]: genTs() };
+for (const dir of C_DIRS) {
+  outputs[join(dir, 'protocol.h')] = genHeader();
+  outputs[join(dir, 'protocol.c')] = genSource();
+}
+
+const check = process.argv.includes('--check');
+let stale = 0;
+for (const [file, text] of Object.entries(outputs)) {
+  const path = join(root, file);
+  const current = existsSync(path) ? readFileSync(path, 'utf8') : null;
+  if (current === text) continue;
+  if (check) {
+    console.error(`${file} is out of date; run node scripts/gen-protocol.mjs`);
+    stale++;
+  } else {
+    writeFileSync(path, text);
+    console.log(`wrote ${file}`);
+  }
+}
+process.exit(stale ? 1 : 0);
@@ -4,6 +4,7 @@
  * Usage: node scripts/generate-icons.mjs <input.svg> <output-dir>
  *
  * Produces:
+ *   icon.svg  – white, cropped source (Linux, rasterized natively)
  *   icon.png  – white, 44×44 (macOS/Linux)
  *   icon.ico  – color, multi-size ICO (Windows)
  */
@@ -76,8 +77,13 @@ function buildIco(pngs, sizes) {
 // ── Generate all icons ──────────────────────────────────────────────
 const cropped = cropSvg(svgSource);
 
+// Linux: white SVG, rasterized by the tray helper at the panel's pixel size
+const white = recolor(cropped, '#FFFFFF');
+writeFileSync(join(outDir, 'icon.svg'), white);
+console.log('  icon.svg  vector white (Linux)');
+
 // macOS + Linux: white on transparent, 32px (16pt @2x Retina)
-const png = renderPng(recolor(cropped, '#FFFFFF'), 32);
+const png = renderPng(white, 32);
 writeFileSync(join(outDir, 'icon.png'), png);
 console.log('  icon.png  32×32  white (macOS/Linux)');
 
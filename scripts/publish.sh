@@ -27,6 +27,9 @@ for pkg in "${NATIVE_PACKAGES[@]}"; do
   if [[ ! -f "$bin" ]]; then
     missing+=("binaries/$pkg/bin/tray${pkg##win32-*}")
   fi
+  if [[ "$pkg" == linux-* && ! -f "$ROOT_DIR/binaries/$pkg/bin/tray-sni" ]]; then
+    missing+=("binaries/$pkg/bin/tray-sni")
+  fi
 done
 
 if [[ ${#missing[@]} -gt 0 ]]; then
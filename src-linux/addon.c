@@ -0,0 +1,209 @@
+/*
+ * In-process Node addon (N-API).  Runs the GTK-free protocol core (main.c
+ * built with -DTRAYJS_SNI -DTRAYJS_ADDON) on its own GLib thread instead
+ * of in a helper process.  Commands and events stay JSON lines; icons can
+ * be handed over as Buffers, which the core reads in place.
+ *
+ *   start(args: string[], onLine: (line: string | null, code?: number) => void)
+ *   command(lines: string[])               concatenated, newline-terminated
+ *   setIcon(png: Buffer, attention: boolean, tray?: number)
+ *   stop()
+ *
+ * onLine(null, code) reports that the core has exited.  The core keeps
+ * global state, so a process hosts one core, once: start() throws after
+ * the first call even when the core has exited since.  Further trays are
+ * added to it with createTray like in a shared helper.
+ *
+ * Build:
+ *   gcc -O2 -shared -fPIC -fvisibility=hidden -DTRAYJS_SNI -DTRAYJS_ADDON -I<node>/include/node addon.c main.c protocol.c sni.c headless.c cJSON.c $(pkg-config --cflags --libs gio-2.0 gdk-pixbuf-2.0 cairo) -lpthread -lm -o trayjs.node
+ */
+
+#include <node_api.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tray.h"
+
+static struct {
+    gboolean                  started, running;
+    int                       exitCode;
+    int                       argc;
+    char                    **argv;
+    napi_threadsafe_function  lines;      /* core thread -> onLine */
+    napi_threadsafe_function  release;    /* core thread -> drop a Buffer reference */
+} gAddon;
+
+/* -----------------------------------------------------------------------
+ * Core thread
+ * ----------------------------------------------------------------------- */
+static void emitLine(char *line) {
+    if (napi_call_threadsafe_function(gAddon.lines, line, napi_tsfn_nonblocking) != napi_ok)
+        free(line);
+}
+
+static void iconDone(void *ref) {
+    napi_call_threadsafe_function(gAddon.release, ref, napi_tsfn_nonblocking);
+}
+
+static void *coreThread(void *arg) {
+    gAddon.exitCode = tray_core_run(gAddon.argc, gAddon.argv, emitLine);
+    napi_call_threadsafe_function(gAddon.lines, NULL, napi_tsfn_nonblocking);   /* exit */
+    napi_release_threadsafe_function(gAddon.lines, napi_tsfn_release);
+    napi_release_threadsafe_function(gAddon.release, napi_tsfn_release);
+    return NULL;
+}
+
+/* -----------------------------------------------------------------------
+ * JS thread
+ * ----------------------------------------------------------------------- */
+static void callLine(napi_env env, napi_value fn, void *context, void *data) {
+    if (!env) { free(data); return; }   /* environment shutting down */
+    napi_value recv, argv[2];
+    napi_get_undefined(env, &recv);
+    if (data) {
+        napi_create_string_utf8(env, data, NAPI_AUTO_LENGTH, &argv[0]);
+        free(data);
+        napi_call_function(env, recv, fn, 1, argv, NULL);
+        return;
+    }
+    gAddon.running = FALSE;
+    g_strfreev(gAddon.argv);
+    gAddon.argv = NULL;
+    napi_get_null(env, &argv[0]);
+    napi_create_int32(env, gAddon.exitCode, &argv[1]);
+    napi_call_function(env, recv, fn, 2, argv, NULL);
+}
+
+static void callRelease(napi_env env, napi_value fn, void *context, void *data) {
+    if (env) napi_delete_reference(env, data);
+}
+
+/* Appends a JS string to the g_malloc'd buffer |*buf|, growing it */
+static napi_status appendString(napi_env env, napi_value v, char **buf, size_t *len, size_t *cap) {
+    size_t n;
+    napi_status st = napi_get_value_string_utf8(env, v, NULL, 0, &n);
+    if (st != napi_ok) return st;
+    if (*len + n + 1 > *cap) {
+        *cap = MAX(*cap * 2, *len + n + 1);
+        *buf = g_realloc(*buf, *cap);
+    }
+    st = napi_get_value_string_utf8(env, v, *buf + *len, n + 1, &n);
+    *len += n;
+    return st;
+}
+
+static napi_value addonStart(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    if (gAddon.started) {
+        napi_throw_error(env, NULL, gAddon.running ? "trayjs: this process already hosts an in-process tray"
+                                                   : "trayjs: the in-process core cannot be restarted");
+        return NULL;
+    }
+    uint32_t n;
+    if (argc < 2 || napi_get_array_length(env, args[0], &n) != napi_ok) {
+        napi_throw_type_error(env, NULL, "trayjs: start(args, onLine)");
+        return NULL;
+    }
+
+    gAddon.argv = g_new0(char *, n + 2);
+    gAddon.argv[0] = g_strdup("trayjs");
+    for (uint32_t i = 0; i < n; i++) {
+        napi_value v;
+        size_t len = 0, cap = 0;
+        napi_get_element(env, args[0], i, &v);
+        if (appendString(env, v, &gAddon.argv[i + 1], &len, &cap) != napi_ok) {
+            g_strfreev(gAddon.argv);
+            gAddon.argv = NULL;
+            napi_throw_type_error(env, NULL, "trayjs: args must be strings");
+            return NULL;
+        }
+    }
+    gAddon.argc = n + 1;
+
+    napi_value name;
+    napi_create_string_utf8(env, "trayjs", NAPI_AUTO_LENGTH, &name);
+    if (napi_create_threadsafe_function(env, args[1], NULL, name, 0, 1, NULL, NULL, NULL,
+                                        callLine, &gAddon.lines) != napi_ok) {
+        g_strfreev(gAddon.argv);
+        gAddon.argv = NULL;
+        napi_throw_type_error(env, NULL, "trayjs: onLine must be a function");
+        return NULL;
+    }
+    /* Like the helper's pipes, the line callback keeps Node alive until the
+       core exits; pending Buffer releases do not */
+    napi_create_threadsafe_function(env, NULL, NULL, name, 0, 1, NULL, NULL, NULL,
+                                    callRelease, &gAddon.release);
+    napi_unref_threadsafe_function(env, gAddon.release);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, coreThread, NULL);
+    pthread_detach(tid);
+    gAddon.started = gAddon.running = TRUE;
+    return NULL;
+}
+
+static napi_value addonCommand(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value arg;
+    uint32_t n;
+    napi_get_cb_info(env, info, &argc, &arg, NULL, NULL);
+    if (argc < 1 || napi_get_array_length(env, arg, &n) != napi_ok) {
+        napi_throw_type_error(env, NULL, "trayjs: command(lines)");
+        return NULL;
+    }
+    if (!gAddon.running) return NULL;
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        napi_value v;
+        napi_get_element(env, arg, i, &v);
+        if (appendString(env, v, &buf, &len, &cap) != napi_ok) {
+            g_free(buf);
+            napi_throw_type_error(env, NULL, "trayjs: lines must be strings");
+            return NULL;
+        }
+    }
+    if (buf) tray_core_command(buf);
+    return NULL;
+}
+
+static napi_value addonSetIcon(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    void *data;
+    size_t len;
+    bool attention = false;
+    int32_t tray = 0;
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    if (argc < 1 || napi_get_buffer_info(env, args[0], &data, &len) != napi_ok) {
+        napi_throw_type_error(env, NULL, "trayjs: setIcon(png, attention, tray)");
+        return NULL;
+    }
+    if (argc > 1) napi_get_value_bool(env, args[1], &attention);
+    if (argc > 2) napi_get_value_int32(env, args[2], &tray);
+    if (!gAddon.running) return NULL;
+    /* The reference pins the Buffer until the core has written it out */
+    napi_ref ref;
+    napi_create_reference(env, args[0], 1, &ref);
+    tray_core_set_icon(tray, data, len, attention, iconDone, ref);
+    return NULL;
+}
+
+static napi_value addonStop(napi_env env, napi_callback_info info) {
+    if (gAddon.running) tray_core_quit();
+    return NULL;
+}
+
+NAPI_MODULE_INIT() {
+    napi_property_descriptor props[] = {
+        { "start",   NULL, addonStart,   NULL, NULL, NULL, napi_default, NULL },
+        { "command", NULL, addonCommand, NULL, NULL, NULL, napi_default, NULL },
+        { "setIcon", NULL, addonSetIcon, NULL, NULL, NULL, napi_default, NULL },
+        { "stop",    NULL, addonStop,    NULL, NULL, NULL, napi_default, NULL },
+    };
+    napi_define_properties(env, exports, G_N_ELEMENTS(props), props);
+    return exports;
+}
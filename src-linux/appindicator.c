@@ -0,0 +1,388 @@
+/*
+ * AppIndicator backend: GTK3 + libayatana-appindicator3.  The menu is
+ * served from a DbusmenuMenuitem tree we own, updated in place.
+ */
+
+#include <gtk/gtk.h>
+#include <libayatana-appindicator/app-indicator.h>
+#include <libdbusmenu-glib/server.h>
+#include <libdbusmenu-glib/menuitem.h>
+#include <string.h>
+
+#include "tray.h"
+
+/* What the AboutToShow filter reads on the GDBus worker thread.  GDBus may
+   still run a filter after remove_filter returns, so this outlives the
+   item: the filter and each held call keep a reference. */
+typedef struct {
+    gint      refs;
+    gint      on;          /* holding root AboutToShow calls */
+    char     *path;        /* dbusmenu object path */
+    TrayItem *item;        /* NULL once destroyed; main thread only */
+} HeldFilter;
+
+struct TrayItem {
+    AppIndicator        *indicator;
+    DbusmenuMenuitem    *menuRoot;
+    const TrayCallbacks *cb;
+    void                *user;
+
+    /* Root AboutToShow calls held back from libdbusmenu, which would answer
+       them at once; see deferAboutToShow below */
+    struct {
+        GDBusConnection *conn;
+        HeldFilter      *filter;
+        guint            filterId;
+        GPtrArray       *calls;      /* GDBusMessage* */
+    } held;
+};
+
+/* -----------------------------------------------------------------------
+ * Menu
+ * ----------------------------------------------------------------------- */
+static void onItemActivated(DbusmenuMenuitem *mi, guint timestamp, gpointer data) {
+    if (dbusmenu_menuitem_get_children(mi)) return;
+    const char *id = g_object_get_data(G_OBJECT(mi), "trayjs-id");
+    TrayItem *item = data;
+    if (id && *id) item->cb->activated(item->user, id);
+}
+
+/*
+ * Hook into the dbusmenu "about-to-show" signal on the root menuitem.
+ * AppIndicator exports the menu over DBus; the desktop shell renders it.
+ * We own the root item, so the hookup survives every setMenu.
+ */
+static void onAboutToShow(DbusmenuMenuitem *mi, gpointer data) {
+    TrayItem *item = data;
+    item->cb->aboutToShow(item->user);
+}
+
+/* Keeps a disabled placeholder so shells never see an empty menu */
+static void ensurePlaceholder(TrayItem *item) {
+    if (dbusmenu_menuitem_get_children(item->menuRoot)) return;
+    DbusmenuMenuitem *ph = dbusmenu_menuitem_new();
+    dbusmenu_menuitem_property_set(ph, DBUSMENU_MENUITEM_PROP_LABEL, "");
+    dbusmenu_menuitem_property_set_bool(ph, DBUSMENU_MENUITEM_PROP_ENABLED, FALSE);
+    g_signal_connect(ph, DBUSMENU_MENUITEM_SIGNAL_ITEM_ACTIVATED,
+                     G_CALLBACK(onItemActivated), item);
+    dbusmenu_menuitem_child_append(item->menuRoot, ph);
+    g_object_unref(ph);
+}
+
+/*
+ * AppIndicator only accepts a GtkMenu, which dbusmenu-gtk then mirrors
+ * into DbusmenuMenuitems.  Swap the server's root for one we build
+ * ourselves so menu updates skip the widget layer entirely.
+ */
+static void initMenuRoot(TrayItem *item) {
+    DbusmenuServer *server = NULL;
+    g_object_get(G_OBJECT(item->indicator), "dbus-menu-server", &server, NULL);
+    if (!server) return;
+    item->menuRoot = dbusmenu_menuitem_new();
+    g_signal_connect(item->menuRoot, DBUSMENU_MENUITEM_SIGNAL_ABOUT_TO_SHOW,
+                     G_CALLBACK(onAboutToShow), item);
+    ensurePlaceholder(item);
+    dbusmenu_server_set_root(server, item->menuRoot);
+    item->held.filter = g_new0(HeldFilter, 1);
+    item->held.filter->refs = 1;
+    item->held.filter->item = item;
+    g_object_get(G_OBJECT(server), "dbus-object", &item->held.filter->path, NULL);
+    g_object_unref(server);
+}
+
+/* -----------------------------------------------------------------------
+ * Deferred AboutToShow
+ *
+ * libdbusmenu replies to AboutToShow with needUpdate=FALSE before the
+ * about-to-show signal handlers could change anything.  A connection
+ * filter takes root AboutToShow calls off the bus instead, and we answer
+ * them once the core has a fresh menu (or gave up waiting).
+ * ----------------------------------------------------------------------- */
+typedef struct {
+    HeldFilter      *filter;
+    GDBusConnection *conn;
+    GDBusMessage    *msg;
+} HeldCall;
+
+static HeldFilter *heldFilterRef(HeldFilter *f) {
+    g_atomic_int_inc(&f->refs);
+    return f;
+}
+
+static void heldFilterUnref(gpointer data) {
+    HeldFilter *f = data;
+    if (!g_atomic_int_dec_and_test(&f->refs)) return;
+    g_free(f->path);
+    g_free(f);
+}
+
+static void replyAboutToShow(GDBusConnection *conn, GDBusMessage *msg, gboolean needUpdate) {
+    GDBusMessage *reply = g_dbus_message_new_method_reply(msg);
+    g_dbus_message_set_body(reply, g_variant_new("(b)", needUpdate));
+    g_dbus_connection_send_message(conn, reply, G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+    g_object_unref(reply);
+    g_object_unref(msg);
+}
+
+static gboolean onHeldAboutToShow(gpointer data) {
+    HeldCall *call = data;
+    TrayItem *item = call->filter->item;
+    if (item) {
+        g_ptr_array_add(item->held.calls, call->msg);
+        item->cb->aboutToShow(item->user);
+    } else {
+        replyAboutToShow(call->conn, call->msg, FALSE);   /* destroyed meanwhile */
+    }
+    heldFilterUnref(call->filter);
+    g_object_unref(call->conn);
+    g_free(call);
+    return G_SOURCE_REMOVE;
+}
+
+/* Runs on the GDBus worker thread */
+static GDBusMessage *aboutToShowFilter(GDBusConnection *conn, GDBusMessage *msg,
+                                       gboolean incoming, gpointer data) {
+    HeldFilter *f = data;
+    if (!incoming || !g_atomic_int_get(&f->on)
+        || g_dbus_message_get_message_type(msg) != G_DBUS_MESSAGE_TYPE_METHOD_CALL
+        || g_strcmp0(g_dbus_message_get_member(msg), "AboutToShow")
+        || g_strcmp0(g_dbus_message_get_interface(msg), "com.canonical.dbusmenu")
+        || g_strcmp0(g_dbus_message_get_path(msg), f->path))
+        return msg;
+    GVariant *body = g_dbus_message_get_body(msg);
+    gint32 id = -1;
+    if (body && g_variant_is_of_type(body, G_VARIANT_TYPE("(i)")))
+        g_variant_get(body, "(i)", &id);
+    if (id != 0) return msg;
+    HeldCall *call = g_new(HeldCall, 1);
+    call->filter = heldFilterRef(f);
+    call->conn = g_object_ref(conn);
+    call->msg = msg;
+    g_main_context_invoke(NULL, onHeldAboutToShow, call);
+    return NULL;
+}
+
+static void appIndicatorReleaseAboutToShow(TrayItem *item, gboolean needUpdate) {
+    for (guint i = 0; item->held.calls && i < item->held.calls->len; i++)
+        replyAboutToShow(item->held.conn, item->held.calls->pdata[i], needUpdate);
+    if (item->held.calls) g_ptr_array_set_size(item->held.calls, 0);
+}
+
+static void appIndicatorDeferAboutToShow(TrayItem *item, gboolean defer) {
+    HeldFilter *f = item->held.filter;
+    if (!f) return;
+    if (defer && !item->held.filterId && f->path) {
+        item->held.conn = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, NULL);
+        if (!item->held.conn) return;
+        item->held.calls = g_ptr_array_new();
+        item->held.filterId = g_dbus_connection_add_filter(item->held.conn, aboutToShowFilter,
+                                                           heldFilterRef(f), heldFilterUnref);
+    }
+    g_atomic_int_set(&f->on, defer);
+    if (!defer) appIndicatorReleaseAboutToShow(item, FALSE);
+}
+
+/* dbusmenu labels use '_' for mnemonics; keep titles literal */
+static char *escapeMnemonic(const char *s) {
+    GString *out = g_string_sized_new(strlen(s) + 4);
+    for (; *s; s++) {
+        if (*s == '_') g_string_append_c(out, '_');
+        g_string_append_c(out, *s);
+    }
+    return g_string_free(out, FALSE);
+}
+
+static void syncMenuItems(TrayItem *item, DbusmenuMenuitem *parent, cJSON *items);
+
+/* Properties are only re-sent over the bus when their value changes. */
+static void setItemProperties(TrayItem *item, DbusmenuMenuitem *mi, cJSON *cfg) {
+    cJSON *jChildren = NULL;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(cfg, "separator"))) {
+        dbusmenu_menuitem_property_set(mi, DBUSMENU_MENUITEM_PROP_TYPE, DBUSMENU_CLIENT_TYPES_SEPARATOR);
+        dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_LABEL);
+        dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_ENABLED);
+        dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_TOGGLE_TYPE);
+        dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_TOGGLE_STATE);
+        g_object_set_data(G_OBJECT(mi), "trayjs-id", NULL);
+    } else {
+        char *label = escapeMnemonic(cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "title")) ?: "");
+        dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_TYPE);
+        dbusmenu_menuitem_property_set(mi, DBUSMENU_MENUITEM_PROP_LABEL, label);
+        g_free(label);
+        if (cJSON_IsFalse(cJSON_GetObjectItem(cfg, "enabled")))
+            dbusmenu_menuitem_property_set_bool(mi, DBUSMENU_MENUITEM_PROP_ENABLED, FALSE);
+        else
+            dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_ENABLED);
+        if (cJSON_IsTrue(cJSON_GetObjectItem(cfg, "checked"))) {
+            dbusmenu_menuitem_property_set(mi, DBUSMENU_MENUITEM_PROP_TOGGLE_TYPE, DBUSMENU_MENUITEM_TOGGLE_CHECK);
+            dbusmenu_menuitem_property_set_int(mi, DBUSMENU_MENUITEM_PROP_TOGGLE_STATE,
+                                               DBUSMENU_MENUITEM_TOGGLE_STATE_CHECKED);
+        } else {
+            dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_TOGGLE_TYPE);
+            dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_TOGGLE_STATE);
+        }
+        const char *itemId = cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "id")) ?: "";
+        if (g_strcmp0(g_object_get_data(G_OBJECT(mi), "trayjs-id"), itemId))
+            g_object_set_data_full(G_OBJECT(mi), "trayjs-id", g_strdup(itemId), g_free);
+        jChildren = cJSON_GetObjectItem(cfg, "items");
+    }
+    if (cJSON_GetArraySize(jChildren) > 0)
+        dbusmenu_menuitem_property_set(mi, DBUSMENU_MENUITEM_PROP_CHILD_DISPLAY,
+                                       DBUSMENU_MENUITEM_CHILD_DISPLAY_SUBMENU);
+    else
+        dbusmenu_menuitem_property_remove(mi, DBUSMENU_MENUITEM_PROP_CHILD_DISPLAY);
+    syncMenuItems(item, mi, jChildren);
+}
+
+/* Updates |parent|'s children in place: existing items are reused by
+ * position, missing ones appended and surplus ones deleted. */
+static void syncMenuItems(TrayItem *item, DbusmenuMenuitem *parent, cJSON *items) {
+    int n = cJSON_GetArraySize(items);
+    GList *l = dbusmenu_menuitem_get_children(parent);
+    for (int i = 0; i < n; i++) {
+        DbusmenuMenuitem *mi;
+        if (l) {
+            mi = l->data;
+            l = l->next;
+        } else {
+            mi = dbusmenu_menuitem_new();
+            g_signal_connect(mi, DBUSMENU_MENUITEM_SIGNAL_ITEM_ACTIVATED,
+                             G_CALLBACK(onItemActivated), item);
+            dbusmenu_menuitem_child_append(parent, mi);
+            g_object_unref(mi);
+        }
+        setItemProperties(item, mi, cJSON_GetArrayItem(items, i));
+    }
+    GList *surplus = g_list_copy(g_list_nth(dbusmenu_menuitem_get_children(parent), n));
+    for (l = surplus; l; l = l->next)
+        dbusmenu_menuitem_child_delete(parent, l->data);
+    g_list_free(surplus);
+}
+
+static void appIndicatorSetMenu(TrayItem *item, cJSON *items) {
+    if (!item->menuRoot) return;
+    syncMenuItems(item, item->menuRoot, items);
+    ensurePlaceholder(item);
+}
+
+/* -----------------------------------------------------------------------
+ * Indicator
+ * ----------------------------------------------------------------------- */
+/* Fired once the StatusNotifierWatcher accepted (or dropped) the item */
+static void onConnectionChanged(AppIndicator *indicator, gboolean connected, gpointer data) {
+    TrayItem *item = data;
+    if (connected) item->cb->registered(item->user);
+}
+
+static void onScrollEvent(AppIndicator *indicator, gint delta, GdkScrollDirection dir, gpointer data) {
+    TrayItem *item = data;
+    switch (dir) {
+    case GDK_SCROLL_UP:    item->cb->scrolled(item->user, 0, -delta); break;
+    case GDK_SCROLL_DOWN:  item->cb->scrolled(item->user, 0, delta); break;
+    case GDK_SCROLL_LEFT:  item->cb->scrolled(item->user, -delta, 0); break;
+    case GDK_SCROLL_RIGHT: item->cb->scrolled(item->user, delta, 0); break;
+    default: break;
+    }
+}
+
+static gboolean appIndicatorInit(int *argc, char ***argv) {
+    return gtk_init_check(argc, argv);
+}
+
+static TrayItem *appIndicatorCreate(const char *iconThemePath, const char *icon, const char *title,
+                                    const TrayCallbacks *cb, void *user) {
+    /* The id names the item's D-Bus paths, so each item needs its own */
+    static int seq;
+    char *id = seq++ ? g_strdup_printf("trayjs-%d", seq) : g_strdup("trayjs");
+    TrayItem *item = g_new0(TrayItem, 1);
+    item->cb = cb;
+    item->user = user;
+    item->indicator = app_indicator_new(id, icon, APP_INDICATOR_CATEGORY_APPLICATION_STATUS);
+    g_free(id);
+    app_indicator_set_icon_theme_path(item->indicator, iconThemePath);
+    app_indicator_set_status(item->indicator, APP_INDICATOR_STATUS_ACTIVE);
+    app_indicator_set_title(item->indicator, title);
+    g_signal_connect(item->indicator, APP_INDICATOR_SIGNAL_CONNECTION_CHANGED,
+                     G_CALLBACK(onConnectionChanged), item);
+    g_signal_connect(item->indicator, APP_INDICATOR_SIGNAL_SCROLL_EVENT,
+                     G_CALLBACK(onScrollEvent), item);
+
+    /* Create menu – must contain at least one item or libdbusmenu
+       will reject it with assertion failures.  Setting it makes
+       AppIndicator export its dbusmenu server, whose root we replace. */
+    GtkWidget *menu = gtk_menu_new();
+    GtkWidget *ph = gtk_menu_item_new_with_label("");
+    gtk_widget_set_sensitive(ph, FALSE);
+    gtk_menu_shell_append(GTK_MENU_SHELL(menu), ph);
+    gtk_widget_show_all(menu);
+    app_indicator_set_menu(item->indicator, GTK_MENU(menu));
+    initMenuRoot(item);
+    return item;
+}
+
+static void appIndicatorDestroy(TrayItem *item) {
+    appIndicatorDeferAboutToShow(item, FALSE);
+    if (item->held.filter) {
+        item->held.filter->item = NULL;   /* calls still queued get answered */
+        g_clear_pointer(&item->held.filter, heldFilterUnref);
+    }
+    if (item->held.filterId) {
+        g_dbus_connection_remove_filter(item->held.conn, item->held.filterId);
+        g_clear_object(&item->held.conn);
+        g_clear_pointer(&item->held.calls, g_ptr_array_unref);
+    }
+    g_clear_object(&item->menuRoot);
+    g_clear_object(&item->indicator);   /* owns the GtkMenu */
+    g_free(item);
+}
+
+static void appIndicatorSetIcon(TrayItem *item, const char *name) {
+    app_indicator_set_icon_full(item->indicator, name, "icon");
+}
+
+static void appIndicatorSetAttentionIcon(TrayItem *item, const char *name) {
+    app_indicator_set_attention_icon_full(item->indicator, name, "attention");
+}
+
+static void appIndicatorSetTitle(TrayItem *item, const char *title) {
+    app_indicator_set_title(item->indicator, title);
+}
+
+static void appIndicatorSetLabel(TrayItem *item, const char *label, const char *guide) {
+    app_indicator_set_label(item->indicator, label, guide);
+}
+
+static void appIndicatorSetStatus(TrayItem *item, TrayStatus status) {
+    static const AppIndicatorStatus map[] = {
+        [TRAY_STATUS_PASSIVE]   = APP_INDICATOR_STATUS_PASSIVE,
+        [TRAY_STATUS_ACTIVE]    = APP_INDICATOR_STATUS_ACTIVE,
+        [TRAY_STATUS_ATTENTION] = APP_INDICATOR_STATUS_ATTENTION,
+    };
+    app_indicator_set_status(item->indicator, map[status]);
+}
+
+/* Largest monitor scale; AppIndicator does not say which one the panel is on */
+static int appIndicatorScaleFactor(void) {
+    int scale = 1;
+    GdkDisplay *d = gdk_display_get_default();
+    int n = d ? gdk_display_get_n_monitors(d) : 0;
+    for (int i = 0; i < n; i++)
+        scale = MAX(scale, gdk_monitor_get_scale_factor(gdk_display_get_monitor(d, i)));
+    return scale;
+}
+
+const TrayBackend trayAppIndicatorBackend = {
+    .name             = "appindicator",
+    .init             = appIndicatorInit,
+    .create           = appIndicatorCreate,
+    .destroy          = appIndicatorDestroy,
+    .setIcon          = appIndicatorSetIcon,
+    .setAttentionIcon = appIndicatorSetAttentionIcon,
+    .setTitle         = appIndicatorSetTitle,
+    .setStatus        = appIndicatorSetStatus,
+    .setMenu          = appIndicatorSetMenu,
+    .setLabel         = appIndicatorSetLabel,
+    .scaleFactor      = appIndicatorScaleFactor,
+    .deferAboutToShow   = appIndicatorDeferAboutToShow,
+    .releaseAboutToShow = appIndicatorReleaseAboutToShow,
+};
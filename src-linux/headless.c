@@ -0,0 +1,248 @@
+/*
+ * Headless backend: keeps the published state in memory and counts what a
+ * real backend would have sent, so the protocol core can be benchmarked and
+ * stress-tested without a display or session bus.
+ *
+ * SIGUSR1 simulates a menu open (menuRequested) on every item, SIGUSR2 one
+ * wheel notch down.  Not in the Node addon, where the signals belong to Node.
+ */
+
+#include <glib-unix.h>
+#include <signal.h>
+#include <string.h>
+
+#include "tray.h"
+
+typedef struct {
+    char      *id;
+    char      *label;
+    gboolean   separator, enabled, checked;
+    GPtrArray *children;   /* HeadlessNode*, NULL for leaves */
+} HeadlessNode;
+
+struct TrayItem {
+    const TrayCallbacks *cb;
+    void                *user;
+    guint                registerId;
+    HeadlessNode         root;
+    char      *icon, *attentionIcon, *title, *label, *guide;
+    TrayStatus status;
+    guint      iconUpdates, titleUpdates, labelUpdates, menuUpdates;
+    guint      itemChanges;    /* item properties a dbusmenu server would resend */
+    guint      itemsAdded, itemsRemoved;
+    gboolean   defer;
+    guint      held;           /* simulated opens awaiting an AboutToShow reply */
+};
+
+static GPtrArray *gItems;      /* TrayItem*, for the simulation signals */
+
+/* -----------------------------------------------------------------------
+ * Menu
+ * ----------------------------------------------------------------------- */
+static void nodeFree(gpointer p) {
+    HeadlessNode *n = p;
+    g_free(n->id);
+    g_free(n->label);
+    if (n->children) g_ptr_array_unref(n->children);
+    g_free(n);
+}
+
+static guint countNodes(HeadlessNode *n) {
+    guint total = 0;
+    for (guint i = 0; n->children && i < n->children->len; i++)
+        total += 1 + countNodes(n->children->pdata[i]);
+    return total;
+}
+
+static void setString(TrayItem *item, char **field, const char *value) {
+    if (!g_strcmp0(*field, value)) return;
+    g_free(*field);
+    *field = g_strdup(value);
+    item->itemChanges++;
+}
+
+static void setFlag(TrayItem *item, gboolean *field, gboolean value) {
+    if (*field == value) return;
+    *field = value;
+    item->itemChanges++;
+}
+
+/* Same positional diff as the AppIndicator backend */
+static void syncNodes(TrayItem *item, HeadlessNode *parent, cJSON *items) {
+    guint n = cJSON_GetArraySize(items);
+    if (!n) {
+        if (parent->children) {
+            item->itemsRemoved += countNodes(parent);
+            g_clear_pointer(&parent->children, g_ptr_array_unref);
+        }
+        return;
+    }
+    if (!parent->children) parent->children = g_ptr_array_new_with_free_func(nodeFree);
+    GPtrArray *kids = parent->children;
+    for (guint i = 0; i < n; i++) {
+        cJSON *cfg = cJSON_GetArrayItem(items, i);
+        if (i == kids->len) {
+            g_ptr_array_add(kids, g_new0(HeadlessNode, 1));
+            item->itemsAdded++;
+        }
+        HeadlessNode *node = kids->pdata[i];
+        gboolean sep = cJSON_IsTrue(cJSON_GetObjectItem(cfg, "separator"));
+        setFlag(item, &node->separator, sep);
+        setString(item, &node->id, sep ? NULL : cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "id")));
+        setString(item, &node->label, sep ? NULL : cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "title")));
+        setFlag(item, &node->enabled, sep || !cJSON_IsFalse(cJSON_GetObjectItem(cfg, "enabled")));
+        setFlag(item, &node->checked, !sep && cJSON_IsTrue(cJSON_GetObjectItem(cfg, "checked")));
+        syncNodes(item, node, sep ? NULL : cJSON_GetObjectItem(cfg, "items"));
+    }
+    while (kids->len > n) {
+        HeadlessNode *extra = kids->pdata[kids->len - 1];
+        item->itemsRemoved += 1 + countNodes(extra);
+        g_ptr_array_set_size(kids, kids->len - 1);
+    }
+}
+
+static void headlessSetMenu(TrayItem *item, cJSON *items) {
+    item->menuUpdates++;
+    syncNodes(item, &item->root, items);
+}
+
+static gboolean onRegistered(gpointer data) {
+    TrayItem *item = data;
+    item->registerId = 0;
+    item->cb->registered(item->user);
+    return G_SOURCE_REMOVE;
+}
+
+#ifndef TRAYJS_ADDON
+static gboolean onSimulateOpen(gpointer data) {
+    for (guint i = 0; i < gItems->len; i++) {
+        TrayItem *item = gItems->pdata[i];
+        if (item->defer) item->held++;
+        item->cb->aboutToShow(item->user);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean onSimulateScroll(gpointer data) {
+    for (guint i = 0; i < gItems->len; i++) {
+        TrayItem *item = gItems->pdata[i];
+        item->cb->scrolled(item->user, 0, 1);
+    }
+    return G_SOURCE_CONTINUE;
+}
+#endif
+
+/* -----------------------------------------------------------------------
+ * Indicator
+ * ----------------------------------------------------------------------- */
+static gboolean headlessInit(int *argc, char ***argv) {
+    gItems = g_ptr_array_new();
+#ifndef TRAYJS_ADDON
+    /* Process-wide: inside Node these would take over the inspector's
+       SIGUSR1 and the app's own SIGUSR2 handlers */
+    g_unix_signal_add(SIGUSR1, onSimulateOpen, NULL);
+    g_unix_signal_add(SIGUSR2, onSimulateScroll, NULL);
+#endif
+    return TRUE;
+}
+
+static TrayItem *headlessCreate(const char *iconThemePath, const char *icon, const char *title,
+                                const TrayCallbacks *cb, void *user) {
+    TrayItem *item = g_new0(TrayItem, 1);
+    item->cb = cb;
+    item->user = user;
+    item->icon = g_strdup(icon);
+    item->title = g_strdup(title);
+    item->status = TRAY_STATUS_ACTIVE;
+    item->registerId = g_idle_add(onRegistered, item);   /* no host to wait for */
+    g_ptr_array_add(gItems, item);
+    return item;
+}
+
+static void headlessDestroy(TrayItem *item) {
+    g_ptr_array_remove(gItems, item);
+    if (item->registerId) g_source_remove(item->registerId);
+    g_clear_pointer(&item->root.children, g_ptr_array_unref);
+    g_free(item->icon);
+    g_free(item->attentionIcon);
+    g_free(item->title);
+    g_free(item->label);
+    g_free(item->guide);
+    g_free(item);
+}
+
+static void headlessSetIcon(TrayItem *item, const char *name) {
+    if (!g_strcmp0(item->icon, name)) return;
+    g_free(item->icon);
+    item->icon = g_strdup(name);
+    item->iconUpdates++;
+}
+
+static void headlessSetAttentionIcon(TrayItem *item, const char *name) {
+    g_free(item->attentionIcon);
+    item->attentionIcon = g_strdup(name);
+}
+
+static void headlessSetTitle(TrayItem *item, const char *title) {
+    if (!g_strcmp0(item->title, title)) return;
+    g_free(item->title);
+    item->title = g_strdup(title);
+    item->titleUpdates++;
+}
+
+static void headlessSetLabel(TrayItem *item, const char *label, const char *guide) {
+    /* Like the real backends, a new guide alone is published too */
+    if (!g_strcmp0(item->label, label) && !g_strcmp0(item->guide, guide)) return;
+    g_free(item->label);
+    item->label = g_strdup(label);
+    g_free(item->guide);
+    item->guide = g_strdup(guide);
+    item->labelUpdates++;
+}
+
+static void headlessSetStatus(TrayItem *item, TrayStatus status) {
+    item->status = status;
+}
+
+static void headlessDeferAboutToShow(TrayItem *item, gboolean defer) {
+    item->defer = defer;
+    if (!defer) item->held = 0;
+}
+
+static void headlessReleaseAboutToShow(TrayItem *item, gboolean needUpdate) {
+    item->held = 0;
+}
+
+static void headlessAddStats(TrayItem *item, cJSON *stats) {
+    static const char *const statusNames[] = { "passive", "active", "attention" };
+    cJSON_AddStringToObject(stats, "icon", item->icon);
+    cJSON_AddStringToObject(stats, "title", item->title);
+    cJSON_AddStringToObject(stats, "status", statusNames[item->status]);
+    cJSON_AddNumberToObject(stats, "iconUpdates", item->iconUpdates);
+    cJSON_AddNumberToObject(stats, "titleUpdates", item->titleUpdates);
+    cJSON_AddStringToObject(stats, "label", item->label ?: "");
+    cJSON_AddNumberToObject(stats, "labelUpdates", item->labelUpdates);
+    cJSON_AddNumberToObject(stats, "menuUpdates", item->menuUpdates);
+    cJSON_AddNumberToObject(stats, "menuItems", countNodes(&item->root));
+    cJSON_AddNumberToObject(stats, "menuItemChanges", item->itemChanges);
+    cJSON_AddNumberToObject(stats, "menuItemsAdded", item->itemsAdded);
+    cJSON_AddNumberToObject(stats, "menuItemsRemoved", item->itemsRemoved);
+    cJSON_AddNumberToObject(stats, "heldOpens", item->held);
+}
+
+const TrayBackend trayHeadlessBackend = {
+    .name             = "headless",
+    .init             = headlessInit,
+    .create           = headlessCreate,
+    .destroy          = headlessDestroy,
+    .setIcon          = headlessSetIcon,
+    .setAttentionIcon = headlessSetAttentionIcon,
+    .setTitle         = headlessSetTitle,
+    .setStatus        = headlessSetStatus,
+    .setMenu          = headlessSetMenu,
+    .setLabel         = headlessSetLabel,
+    .scaleFactor      = tray_env_scale_factor,
+    .addStats         = headlessAddStats,
+    .deferAboutToShow   = headlessDeferAboutToShow,
+    .releaseAboutToShow = headlessReleaseAboutToShow,
+};
@@ -1,50 +1,214 @@
 /*
  * Native Linux tray helper – JSON-lines stdin/stdout protocol.
- * Uses GTK3 + libayatana-appindicator3 for StatusNotifierItem support.
+ * This file is the protocol core: parsing, icon rendering and scheduling.
+ * The tray item itself is shown by a backend (tray.h), picked with
+ * --backend: GTK3 + libayatana-appindicator3 (appindicator.c), or with
+ * -DTRAYJS_SNI a GTK-free StatusNotifierItem over GDBus (sni.c).  Both
+ * builds also include an in-memory backend for benchmarks (headless.c).
+ * With -DTRAYJS_ADDON there is no main() or stdio: addon.c embeds the core
+ * in a Node process through the tray_core_* functions (tray.h).
+ * One process can show several tray items: the helper starts with tray 0,
+ * createTray adds more, and a "tray" field addresses commands and events.
+ * With --daemon PATH the helper serves one client at a time on a Unix
+ * socket instead of stdio and keeps its trays shown between clients.
  * Build:
- *   gcc -O2 main.c cJSON.c $(pkg-config --cflags --libs gtk+-3.0 ayatana-appindicator3-0.1) -lpthread -o tray
+ *   gcc -O2 main.c appindicator.c headless.c cJSON.c $(pkg-config --cflags --libs gtk+-3.0 ayatana-appindicator3-0.1 dbusmenu-glib-0.4) -lpthread -lm -o tray
+ *   gcc -O2 -DTRAYJS_SNI main.c sni.c headless.c cJSON.c $(pkg-config --cflags --libs gio-2.0 gdk-pixbuf-2.0 cairo) -lpthread -lm -o tray-sni
  */
 
-#include <gtk/gtk.h>
+#include <gio/gio.h>
 #include <glib/gstdio.h>
-#include <libayatana-appindicator/app-indicator.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <cairo.h>
+#include <glib-unix.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
 #include <pthread.h>
 #include <string.h>
+#include <time.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include "cJSON.h"
+#include "protocol.h"
+#include "tray.h"
 
 /* -----------------------------------------------------------------------
  * Globals
  * ----------------------------------------------------------------------- */
-static AppIndicator    *gIndicator;
-static GtkWidget       *gMenu;
+typedef struct { double r, g, b, a; gboolean on; } Paint;
+
+enum { PROP_ICON, PROP_ATTENTION_ICON, PROP_TITLE, PROP_STATUS, PROP_LABEL, PROP_COUNT };
+
+#define MENU_PENDING_MAX_US (5 * G_USEC_PER_SEC)   /* give up on a lost menu reply */
+
+/* Everything one tray item shows and schedules; the sections below
+   explain each part */
+typedef struct {
+    int         id;                /* 0 for the item the helper starts with */
+    TrayItem   *item;
+
+    /* menuRequested carries a requestId that Node echoes in its setMenu.
+       One request is outstanding at a time, and opens within |windowMs| of
+       the last request are folded into it. */
+    struct {
+        int       windowMs;
+        guint     seq, pending;    /* pending: unanswered requestId or 0 */
+        gint64    lastUs;
+        guint     emitted, collapsed, kept;
+    } menuReq;
+
+    /* With a menu deadline the host's AboutToShow is answered only once
+       Node's setMenu arrives (hit) or the deadline passes (miss) */
+    struct {
+        int       deadlineMs;      /* 0 when off */
+        guint     timerId;         /* running while a reply is held */
+        guint     hits, misses;
+    } menuWait;
+
+    char       *baseIconName;      /* icon shown when no overlay is active */
+    char       *attentionIconName;
+    GdkPixbuf  *baseIcon;          /* decoded lazily for compositing */
+    char       *badge;             /* NULL when hidden, "" for a dot */
+    int         progress;          /* percent, -1 when hidden */
+    GHashTable *overlayCache;      /* overlay key -> icon name */
+    GPtrArray  *retired;           /* replaced icon files, unlinked after the next flush */
+
+    /* Sparkline mode: a ring buffer of samples redrawn at most |fps| times/s */
+    struct {
+        gboolean  on;
+        double   *samples;
+        int       cap, len, head;
+        double    min, max;        /* fixed range, or NaN to auto-scale */
+        Paint     color;
+        int       fps;
+        gint64    lastFrame;
+        guint     frameId;
+        char     *frames[2];       /* last two frame files, older one unlinked */
+    } spark;
+
+    /* Icon loaded from a local path, optionally reloaded when it changes */
+    struct {
+        char         *path;
+        GFileMonitor *monitor;
+        guint         reloadId;
+        char         *link;        /* last symlink's icon name, retired when replaced */
+    } iconFile;
+
+    /* setLabel is meant for live values, so on top of the frame it is
+       capped at |maxRate| publishes per second; the newest text always wins */
+    struct {
+        char     *text, *guide;
+        int       maxRate;
+        guint     timerId;
+        gint64    last;
+        guint     updates;
+    } label;
+
+    struct {
+        char     *want[PROP_COUNT];    /* latest requested value */
+        char     *shown[PROP_COUNT];   /* last value handed to the backend */
+        guint     flushId;
+        gint64    lastFlush;
+        guint     updates, published;
+    } props;
+
+    struct {
+        gboolean  on;
+        int       prop;            /* PROP_LABEL or PROP_TITLE */
+        char     *format;
+        gint64    from, to;        /* epoch ms; 0 when unset */
+        int       intervalMs;
+        guint     timerId;
+        guint     ticks;
+    } ticker;
+
+    /* Wheel notches are summed and sent at most once per |windowMs| */
+    struct {
+        int       windowMs;
+        int       dx, dy, count;   /* accumulated since the last event */
+        gint64    last;
+        guint     timerId;
+        guint     raw, sent;
+    } scroll;
+
+    gint64      createdUs, registeredUs;
+    guint       registrations;
+
+    /* proto_line_digest of the line each slot shows, 0 if unknown; a daemon
+       reports them so that a resuming client skips repeating them */
+    uint32_t    lines[PROTO_SLOT_COUNT];
+} Tray;
+
+static const TrayBackend *gBackend;
+static GHashTable      *gTrays;          /* id -> Tray* */
+
+/* Command-line settings for tray 0, and for createTray options left unset */
+static struct {
+    int   menuDeadlineMs, menuWindowMs, scrollWindowMs;
+} gDefaults = { .menuWindowMs = 100, .scrollWindowMs = 50 };
+
+static GMainLoop       *gLoop;
+#ifdef TRAYJS_ADDON
+static void           (*gEmitLine)(char *line);
+#else
 static pthread_mutex_t  gOutputLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* --daemon: output goes to the connected client, if any */
+static struct {
+    const char *path;
+    int         listenFd;
+    FILE       *in, *out;          /* current client; |in| is read on its own thread */
+    guint       clients;
+} gDaemon = { .listenFd = -1 };
+#endif
 static char            *gIconDir;
 static int              gIconSeq;
-static gboolean         gBuildingMenu;
-static GObject         *gDbusmenuRoot;
-static gulong           gAboutToShowId;
+static GHashTable      *gRenderCache;    /* "size\x1fsource" -> icon name */
+static int              gIconSize = 22;  /* logical panel icon size */
+
+/* Protocol counters reported by getStats; bytesIn and parseUs are
+   updated on the stdin thread under gStatsLock */
+static pthread_mutex_t  gStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    gint64  startUs;
+    guint   commands, unknown;
+    gint64  bytesIn;
+    gint64  parseUs, dispatchUs;
+} gStats;
+
+#define ICON_CACHE_MAX 64
 
 /* -----------------------------------------------------------------------
  * JSON output
  * ----------------------------------------------------------------------- */
-static void emit(const char *method, cJSON *params) {
+/* |t| addresses the event; NULL for process-wide ones */
+static void emit(Tray *t, const char *method, cJSON *params) {
     cJSON *msg = cJSON_CreateObject();
+    if (t && t->id) cJSON_AddNumberToObject(msg, "tray", t->id);
     cJSON_AddStringToObject(msg, "method", method);
     if (params) cJSON_AddItemToObject(msg, "params", params);
     char *str = cJSON_PrintUnformatted(msg);
+#ifdef TRAYJS_ADDON
+    if (str) gEmitLine(str);
+#else
     if (str) {
         pthread_mutex_lock(&gOutputLock);
-        fputs(str, stdout);
-        fputc('\n', stdout);
-        fflush(stdout);
+        FILE *out = gDaemon.path ? gDaemon.out : stdout;   /* none between clients */
+        if (out) {
+            fputs(str, out);
+            fputc('\n', out);
+            fflush(out);
+        }
         pthread_mutex_unlock(&gOutputLock);
         free(str);
     }
+#endif
     cJSON_Delete(msg);
 }
 
@@ -79,6 +243,109 @@ static unsigned char *base64Decode(const char *src, size_t *outLen) {
     return out;
 }
 
+/* -----------------------------------------------------------------------
+ * Indicator properties
+ *
+ * Every published property costs a D-Bus signal and a shell repaint, so
+ * changes are collected and flushed at most once per frame: the first
+ * change after a quiet frame goes out at once, a burst after it is folded
+ * into one flush carrying only the values that actually differ.
+ * ----------------------------------------------------------------------- */
+#define PROP_FRAME_US (G_USEC_PER_SEC / 60)
+
+static void unlinkIcon(const char *name) {
+    char *file = g_strdup_printf("%s.png", name);
+    char *path = g_build_filename(gIconDir, file, NULL);
+    g_unlink(path);
+    g_free(path); g_free(file);
+}
+
+static void flushProps(Tray *t) {
+    if (t->props.flushId) g_source_remove(t->props.flushId);
+    t->props.flushId = 0;
+    t->props.lastFlush = g_get_monotonic_time();
+    for (int i = 0; i < PROP_COUNT; i++) {
+        const char *v = t->props.want[i];
+        if (!v || !g_strcmp0(v, t->props.shown[i])) continue;
+        g_free(t->props.shown[i]);
+        t->props.shown[i] = g_strdup(v);
+        t->props.published++;
+        switch (i) {
+        case PROP_ICON:           gBackend->setIcon(t->item, v); break;
+        case PROP_ATTENTION_ICON: gBackend->setAttentionIcon(t->item, v); break;
+        case PROP_TITLE:          gBackend->setTitle(t->item, v); break;
+        case PROP_LABEL:          gBackend->setLabel(t->item, v, t->label.guide); break;
+        case PROP_STATUS:
+            gBackend->setStatus(t->item, !strcmp(v, "attention") ? TRAY_STATUS_ATTENTION
+                                : !strcmp(v, "passive") ? TRAY_STATUS_PASSIVE : TRAY_STATUS_ACTIVE);
+            break;
+        }
+    }
+    /* Their replacements are published now; one still shown (its
+       replacement failed to render) waits for the next flush */
+    for (guint i = t->retired->len; i-- > 0; ) {
+        const char *name = t->retired->pdata[i];
+        if (g_strcmp0(name, t->props.shown[PROP_ICON]) && g_strcmp0(name, t->props.shown[PROP_ATTENTION_ICON])) {
+            unlinkIcon(name);
+            g_ptr_array_remove_index(t->retired, i);
+        }
+    }
+}
+
+static gboolean onPropsFrame(gpointer data) {
+    Tray *t = data;
+    t->props.flushId = 0;
+    flushProps(t);
+    return G_SOURCE_REMOVE;
+}
+
+static void setProp(Tray *t, int prop, const char *value) {
+    t->props.updates++;
+    if (!g_strcmp0(value, t->props.want[prop])) return;
+    g_free(t->props.want[prop]);
+    t->props.want[prop] = g_strdup(value);
+    if (t->props.flushId) return;
+    gint64 wait = t->props.lastFlush + PROP_FRAME_US - g_get_monotonic_time();
+    if (wait <= 0) flushProps(t);
+    else t->props.flushId = g_timeout_add((guint)(wait / 1000) + 1, onPropsFrame, t);
+}
+
+static gboolean onLabelDue(gpointer data) {
+    Tray *t = data;
+    t->label.timerId = 0;
+    t->label.last = g_get_monotonic_time();
+    setProp(t, PROP_LABEL, t->label.text);
+    return G_SOURCE_REMOVE;
+}
+
+static void setLabel(Tray *t, const char *text, const char *guide, int maxRate) {
+    t->label.updates++;
+    g_free(t->label.text);
+    t->label.text = g_strdup(text);
+    if (g_strcmp0(guide, t->label.guide)) {
+        g_free(t->label.guide);
+        t->label.guide = g_strdup(guide);
+        /* Republish with it, even if the text stays the same */
+        g_clear_pointer(&t->props.want[PROP_LABEL], g_free);
+        g_clear_pointer(&t->props.shown[PROP_LABEL], g_free);
+    }
+    if (maxRate > 0) t->label.maxRate = maxRate;
+    if (t->label.timerId) return;
+    gint64 wait = t->label.last + G_USEC_PER_SEC / t->label.maxRate - g_get_monotonic_time();
+    if (wait <= 0) onLabelDue(t);
+    else t->label.timerId = g_timeout_add((guint)(wait / 1000) + 1, onLabelDue, t);
+}
+
+/* Values the backend was initialized with */
+static void initProps(Tray *t, const char *icon, const char *title) {
+    t->props.want[PROP_ICON] = g_strdup(icon);
+    t->props.shown[PROP_ICON] = g_strdup(icon);
+    t->props.want[PROP_TITLE] = g_strdup(title);
+    t->props.shown[PROP_TITLE] = g_strdup(title);
+    t->props.want[PROP_STATUS] = g_strdup("active");
+    t->props.shown[PROP_STATUS] = g_strdup("active");
+}
+
 /* -----------------------------------------------------------------------
  * Default icon: 22x22 green circle (#2ead33)
  * ----------------------------------------------------------------------- */
@@ -104,219 +371,1405 @@ static void writeDefaultIcon(void) {
 }
 
 /* -----------------------------------------------------------------------
- * Menu
+ * Rendered icon files
  * ----------------------------------------------------------------------- */
-static void onActivate(GtkMenuItem *item, gpointer data) {
-    if (gBuildingMenu) return;
-    const char *id = g_object_get_data(G_OBJECT(item), "trayjs-id");
-    if (id && *id) {
-        cJSON *p = cJSON_CreateObject();
-        cJSON_AddStringToObject(p, "id", id);
-        emit("clicked", p);
+static char *writeIconSurface(cairo_surface_t *s, const char *prefix) {
+    char *name = g_strdup_printf("%s-%d", prefix, ++gIconSeq);
+    char *file = g_strdup_printf("%s.png", name);
+    char *path = g_build_filename(gIconDir, file, NULL);
+    cairo_status_t st = cairo_surface_write_to_png(s, path);
+    g_free(path); g_free(file);
+    if (st != CAIRO_STATUS_SUCCESS) { g_free(name); return NULL; }
+    return name;
+}
+
+/* TRUE if a tray uses |name| as its base or attention icon, or still shows
+   it until the next flush */
+static gboolean iconInUse(const char *name) {
+    GHashTableIter it;
+    gpointer value;
+    g_hash_table_iter_init(&it, gTrays);
+    while (g_hash_table_iter_next(&it, NULL, &value)) {
+        Tray *t = value;
+        if (!g_strcmp0(name, t->baseIconName) || !g_strcmp0(name, t->attentionIconName)
+            || !g_strcmp0(name, t->props.shown[PROP_ICON]) || !g_strcmp0(name, t->props.shown[PROP_ATTENTION_ICON]))
+            return TRUE;
     }
+    return FALSE;
 }
 
-/*
- * Hook into the dbusmenu "about-to-show" signal on the root menuitem.
- * AppIndicator exports the menu over DBus; the desktop shell renders it.
- * GTK "show" never fires from user interaction, so we use the dbusmenu
- * layer instead.  All access is through GObject properties so no extra
- * headers are needed.
- */
-static void onAboutToShow(GObject *item, gpointer d) {
-    emit("menuRequested", NULL);
+/* Drops cached renderings and their files, optionally keeping the ones
+ * currently used as a base or attention icon. */
+static void evictIconCache(GHashTable *cache, gboolean keepInUse) {
+    GHashTableIter it;
+    gpointer name;
+    g_hash_table_iter_init(&it, cache);
+    while (g_hash_table_iter_next(&it, NULL, &name)) {
+        if (keepInUse && iconInUse(name)) continue;
+        unlinkIcon(name);
+        g_hash_table_iter_remove(&it);
+    }
 }
 
-static void connectAboutToShow(void);
+/* Pixel size for natively rendered icons: panel size times the largest
+ * monitor scale.  AppIndicator does not tell us the size the shell will
+ * draw at, so this is the closest match we can render for. */
+static int iconPixelSize(void) {
+    return gIconSize * gBackend->scaleFactor();
+}
 
-static gboolean deferredConnectAboutToShow(gpointer data) {
-    connectAboutToShow();
-    return G_SOURCE_REMOVE;
+/* No display connection without GDK; honor the same override it uses */
+int tray_env_scale_factor(void) {
+    const char *env = g_getenv("GDK_SCALE");
+    return env ? MAX(1, atoi(env)) : 1;
 }
 
-static void connectAboutToShow(void) {
-    if (gDbusmenuRoot && gAboutToShowId) {
-        g_signal_handler_disconnect(gDbusmenuRoot, gAboutToShowId);
-        g_object_unref(gDbusmenuRoot);
-        gDbusmenuRoot = NULL;
-        gAboutToShowId = 0;
-    }
-    GObject *server = NULL;
-    g_object_get(G_OBJECT(gIndicator), "dbus-menu-server", &server, NULL);
-    if (!server) return;
-    g_object_get(server, "root-node", &gDbusmenuRoot, NULL);
-    g_object_unref(server);
-    if (!gDbusmenuRoot) return;
-    gAboutToShowId = g_signal_connect(gDbusmenuRoot, "about-to-show",
-                                      G_CALLBACK(onAboutToShow), NULL);
-}
-
-static void buildMenuItems(GtkMenuShell *shell, cJSON *items) {
-    int n = cJSON_GetArraySize(items);
-    for (int i = 0; i < n; i++) {
-        cJSON *cfg = cJSON_GetArrayItem(items, i);
-        if (cJSON_IsTrue(cJSON_GetObjectItem(cfg, "separator"))) {
-            gtk_menu_shell_append(shell, gtk_separator_menu_item_new());
-            continue;
+/* -----------------------------------------------------------------------
+ * Badge / progress overlays
+ *
+ * Overlays are composited onto the base icon with cairo and written to the
+ * icon directory once per distinct (badge, progress) pair, so flipping back
+ * to a previously shown value only swaps the icon name.
+ * ----------------------------------------------------------------------- */
+static cairo_surface_t *surfaceFromPixbuf(GdkPixbuf *pb) {
+    int w = gdk_pixbuf_get_width(pb), h = gdk_pixbuf_get_height(pb);
+    int nch = gdk_pixbuf_get_n_channels(pb);
+    int srcStride = gdk_pixbuf_get_rowstride(pb);
+    const guchar *src = gdk_pixbuf_get_pixels(pb);
+    cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+    cairo_surface_flush(s);
+    guchar *dst = cairo_image_surface_get_data(s);
+    int dstStride = cairo_image_surface_get_stride(s);
+    for (int y = 0; y < h; y++) {
+        const guchar *sp = src + y * srcStride;
+        guint32 *dp = (guint32 *)(dst + y * dstStride);
+        for (int x = 0; x < w; x++, sp += nch) {
+            guint a = nch == 4 ? sp[3] : 0xff;
+            dp[x] = (a << 24) | ((sp[0] * a / 255) << 16) |
+                    ((sp[1] * a / 255) << 8) | (sp[2] * a / 255);
         }
-        const char *title = cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "title")) ?: "";
-        const char *itemId = cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "id")) ?: "";
-        cJSON *jChildren = cJSON_GetObjectItem(cfg, "items");
-
-        GtkWidget *mi;
-        if (cJSON_IsTrue(cJSON_GetObjectItem(cfg, "checked"))) {
-            mi = gtk_check_menu_item_new_with_label(title);
-            gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(mi), TRUE);
-        } else {
-            mi = gtk_menu_item_new_with_label(title);
+    }
+    cairo_surface_mark_dirty(s);
+    return s;
+}
+
+static void drawProgress(cairo_t *cr, int w, int h, int percent) {
+    double bh = MAX(2.0, h / 7.0);
+    cairo_rectangle(cr, 0, h - bh, w, bh);
+    cairo_set_source_rgba(cr, 0, 0, 0, 0.6);
+    cairo_fill(cr);
+    cairo_rectangle(cr, 0, h - bh, w * percent / 100.0, bh);
+    cairo_set_source_rgb(cr, 0x2e / 255.0, 0xad / 255.0, 0x33 / 255.0);
+    cairo_fill(cr);
+}
+
+static void drawBadge(cairo_t *cr, int w, int h, const char *text) {
+    double r = *text ? h * 0.3 : h * 0.18;
+    cairo_text_extents_t ext = {0};
+    if (*text) {
+        cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+        cairo_set_font_size(cr, r * 1.4);
+        cairo_text_extents(cr, text, &ext);
+    }
+    /* Pill that grows to the left for multi-character badges */
+    double pw = MIN((double)w, MAX(2 * r, ext.x_advance + r));
+    double x = w - pw;
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, x + r, r, r, M_PI / 2, 3 * M_PI / 2);
+    cairo_arc(cr, x + pw - r, r, r, 3 * M_PI / 2, M_PI / 2);
+    cairo_close_path(cr);
+    cairo_set_source_rgb(cr, 0xe5 / 255.0, 0x39 / 255.0, 0x35 / 255.0);
+    cairo_fill(cr);
+    if (*text) {
+        cairo_set_source_rgb(cr, 1, 1, 1);
+        cairo_move_to(cr, x + (pw - ext.width) / 2 - ext.x_bearing,
+                      r - ext.height / 2 - ext.y_bearing);
+        cairo_show_text(cr, text);
+    }
+}
+
+static char *renderOverlay(Tray *t) {
+    if (!t->baseIcon) {
+        char *file = g_strdup_printf("%s.png", t->baseIconName);
+        char *path = g_build_filename(gIconDir, file, NULL);
+        t->baseIcon = gdk_pixbuf_new_from_file(path, NULL);
+        g_free(path); g_free(file);
+        if (!t->baseIcon) return NULL;
+    }
+    cairo_surface_t *s = surfaceFromPixbuf(t->baseIcon);
+    int w = cairo_image_surface_get_width(s), h = cairo_image_surface_get_height(s);
+    cairo_t *cr = cairo_create(s);
+    if (t->progress >= 0) drawProgress(cr, w, h, t->progress);
+    if (t->badge) drawBadge(cr, w, h, t->badge);
+    cairo_destroy(cr);
+    char *name = writeIconSurface(s, "trayjs-overlay");
+    cairo_surface_destroy(s);
+    return name;
+}
+
+/* Drops the overlays; the one shown stays on disk until its replacement
+   is published */
+static void retireOverlays(Tray *t) {
+    GHashTableIter it;
+    gpointer name;
+    g_hash_table_iter_init(&it, t->overlayCache);
+    while (g_hash_table_iter_next(&it, NULL, &name))
+        g_ptr_array_add(t->retired, g_strdup(name));
+    g_hash_table_remove_all(t->overlayCache);
+}
+
+static void publishIcon(Tray *t) {
+    if (!t->badge && t->progress < 0) {
+        setProp(t, PROP_ICON, t->baseIconName);
+        return;
+    }
+    char *key = g_strdup_printf("%c%s\x1f%d", t->badge ? 'b' : '-', t->badge ? t->badge : "", t->progress);
+    const char *name = g_hash_table_lookup(t->overlayCache, key);
+    if (!name) {
+        if (g_hash_table_size(t->overlayCache) >= ICON_CACHE_MAX)
+            retireOverlays(t);
+        char *rendered = renderOverlay(t);
+        if (!rendered) { g_free(key); return; }
+        g_hash_table_insert(t->overlayCache, key, rendered);
+        name = rendered;
+    } else {
+        g_free(key);
+    }
+    setProp(t, PROP_ICON, name);
+}
+
+static void setBaseIcon(Tray *t, const char *name) {
+    if (!g_strcmp0(name, t->baseIconName)) return;
+    g_free(t->baseIconName);
+    t->baseIconName = g_strdup(name);
+    g_clear_object(&t->baseIcon);
+    retireOverlays(t);
+    publishIcon(t);
+}
+
+/* -----------------------------------------------------------------------
+ * Vector icons
+ *
+ * A compact command list rasterized with cairo at the requested size.
+ * Coordinates are in a 100x100 box; commands are separated by ';':
+ *   F#rgb[a] | F-            set / clear fill (default white)
+ *   S#rgb[a][,w] | S-        set / clear stroke and its width
+ *   c cx,cy,r                circle
+ *   r x,y,w,h[,radius]       (rounded) rectangle
+ *   a cx,cy,r,from,to        arc, degrees clockwise from 12 o'clock
+ *   t x,y,size,text          text centered on x,y; 'T' for bold
+ * ----------------------------------------------------------------------- */
+static const char *skipSpace(const char *s) {
+    while (*s == ' ') s++;
+    return s;
+}
+
+static int parseNumbers(const char **sp, double *out, int max) {
+    const char *s = skipSpace(*sp);
+    int n = 0;
+    while (n < max) {
+        char *end;
+        double v = g_ascii_strtod(s, &end);
+        if (end == s) break;
+        out[n++] = v;
+        s = skipSpace(end);
+        if (*s != ',') break;
+        s = skipSpace(s + 1);
+    }
+    *sp = s;
+    return n;
+}
+
+static gboolean parseColor(const char **sp, Paint *p) {
+    const char *s = skipSpace(*sp);
+    if (*s == '-') { p->on = FALSE; *sp = s + 1; return TRUE; }
+    if (*s++ != '#') return FALSE;
+    guint v = 0;
+    int n = 0;
+    for (; n < 8 && g_ascii_isxdigit(*s); s++, n++) v = (v << 4) | g_ascii_xdigit_value(*s);
+    guint r, g, b, a = 0xff;
+    if (n == 3) {
+        r = ((v >> 8) & 0xf) * 17; g = ((v >> 4) & 0xf) * 17; b = (v & 0xf) * 17;
+    } else if (n == 6) {
+        r = (v >> 16) & 0xff; g = (v >> 8) & 0xff; b = v & 0xff;
+    } else if (n == 8) {
+        r = v >> 24; g = (v >> 16) & 0xff; b = (v >> 8) & 0xff; a = v & 0xff;
+    } else {
+        return FALSE;
+    }
+    *p = (Paint){ r / 255.0, g / 255.0, b / 255.0, a / 255.0, TRUE };
+    *sp = s;
+    return TRUE;
+}
+
+static void paintPath(cairo_t *cr, const Paint *fill, const Paint *stroke, double width) {
+    if (fill && fill->on) {
+        cairo_set_source_rgba(cr, fill->r, fill->g, fill->b, fill->a);
+        cairo_fill_preserve(cr);
+    }
+    if (stroke->on) {
+        cairo_set_source_rgba(cr, stroke->r, stroke->g, stroke->b, stroke->a);
+        cairo_set_line_width(cr, width);
+        cairo_stroke_preserve(cr);
+    }
+    cairo_new_path(cr);
+}
+
+static void roundedRect(cairo_t *cr, double x, double y, double w, double h, double r) {
+    r = MIN(r, MIN(w, h) / 2);
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, x + w - r, y + r, r, -M_PI / 2, 0);
+    cairo_arc(cr, x + w - r, y + h - r, r, 0, M_PI / 2);
+    cairo_arc(cr, x + r, y + h - r, r, M_PI / 2, M_PI);
+    cairo_arc(cr, x + r, y + r, r, M_PI, 3 * M_PI / 2);
+    cairo_close_path(cr);
+}
+
+static gboolean drawVector(cairo_t *cr, const char *cmds, int size) {
+    Paint fill = { 1, 1, 1, 1, TRUE }, stroke = { 0 };
+    double strokeWidth = 8, a[5];
+    cairo_scale(cr, size / 100.0, size / 100.0);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+    cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+
+    const char *s = cmds;
+    while (*(s = skipSpace(s))) {
+        char op = *s++;
+        switch (op) {
+        case 'F':
+            if (!parseColor(&s, &fill)) return FALSE;
+            break;
+        case 'S':
+            if (!parseColor(&s, &stroke)) return FALSE;
+            if (*s == ',') {
+                s++;
+                if (parseNumbers(&s, &strokeWidth, 1) != 1) return FALSE;
+            }
+            break;
+        case 'c':
+            if (parseNumbers(&s, a, 3) != 3) return FALSE;
+            cairo_arc(cr, a[0], a[1], a[2], 0, 2 * M_PI);
+            paintPath(cr, &fill, &stroke, strokeWidth);
+            break;
+        case 'r': {
+            int n = parseNumbers(&s, a, 5);
+            if (n < 4) return FALSE;
+            roundedRect(cr, a[0], a[1], a[2], a[3], n == 5 ? a[4] : 0);
+            paintPath(cr, &fill, &stroke, strokeWidth);
+            break;
+        }
+        case 'a':
+            if (parseNumbers(&s, a, 5) != 5) return FALSE;
+            cairo_arc(cr, a[0], a[1], a[2], (a[3] - 90) * M_PI / 180, (a[4] - 90) * M_PI / 180);
+            paintPath(cr, NULL, &stroke, strokeWidth);
+            break;
+        case 't':
+        case 'T': {
+            if (parseNumbers(&s, a, 3) != 3) return FALSE;
+            const char *end = strchr(s, ';');
+            char *text = end ? g_strndup(s, end - s) : g_strdup(s);
+            s = end ? end : s + strlen(s);
+            cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL,
+                                   op == 'T' ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
+            cairo_set_font_size(cr, a[2]);
+            cairo_text_extents_t ext;
+            cairo_text_extents(cr, text, &ext);
+            cairo_move_to(cr, a[0] - ext.width / 2 - ext.x_bearing,
+                          a[1] - ext.height / 2 - ext.y_bearing);
+            cairo_text_path(cr, text);
+            g_free(text);
+            paintPath(cr, &fill, &stroke, strokeWidth);
+            break;
+        }
+        default:
+            return FALSE;
         }
+        s = skipSpace(s);
+        if (*s == ';') s++;
+        else if (*s) return FALSE;
+    }
+    return TRUE;
+}
 
-        g_object_set_data_full(G_OBJECT(mi), "trayjs-id", g_strdup(itemId), g_free);
-        if (cJSON_IsFalse(cJSON_GetObjectItem(cfg, "enabled")))
-            gtk_widget_set_sensitive(mi, FALSE);
+static char *renderVector(const char *cmds, gsize len, int size) {
+    cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    cairo_t *cr = cairo_create(s);
+    gboolean ok = drawVector(cr, cmds, size);
+    cairo_destroy(cr);
+    char *name = ok ? writeIconSurface(s, "trayjs-vector") : NULL;
+    cairo_surface_destroy(s);
+    return name;
+}
+
+/* -----------------------------------------------------------------------
+ * SVG icons, rasterized through gdk-pixbuf's SVG loader
+ * ----------------------------------------------------------------------- */
+static void onSvgSizePrepared(GdkPixbufLoader *loader, int w, int h, gpointer data) {
+    int size = GPOINTER_TO_INT(data);
+    double scale = (double)size / MAX(w, h);
+    gdk_pixbuf_loader_set_size(loader, MAX(1, (int)(w * scale + 0.5)), MAX(1, (int)(h * scale + 0.5)));
+}
 
-        if (cJSON_IsArray(jChildren) && cJSON_GetArraySize(jChildren) > 0) {
-            GtkWidget *sub = gtk_menu_new();
-            buildMenuItems(GTK_MENU_SHELL(sub), jChildren);
-            gtk_menu_item_set_submenu(GTK_MENU_ITEM(mi), sub);
-        } else {
-            g_signal_connect(mi, "activate", G_CALLBACK(onActivate), NULL);
+/* Whether gdk-pixbuf has an SVG loader (librsvg's) */
+static gboolean svgSupported(void) {
+    static int supported = -1;
+    if (supported < 0) {
+        GdkPixbufLoader *loader = gdk_pixbuf_loader_new_with_mime_type("image/svg+xml", NULL);
+        supported = loader != NULL;
+        if (loader) {
+            gdk_pixbuf_loader_close(loader, NULL);
+            g_object_unref(loader);
         }
-        gtk_menu_shell_append(shell, mi);
     }
+    return supported;
+}
+
+static char *renderSvg(const char *svg, gsize len, int size) {
+    GdkPixbufLoader *loader = gdk_pixbuf_loader_new_with_mime_type("image/svg+xml", NULL);
+    if (!loader) return NULL;
+    g_signal_connect(loader, "size-prepared", G_CALLBACK(onSvgSizePrepared), GINT_TO_POINTER(size));
+    char *name = NULL;
+    gboolean ok = gdk_pixbuf_loader_write(loader, (const guchar *)svg, len, NULL);
+    if (gdk_pixbuf_loader_close(loader, NULL) && ok) {
+        GdkPixbuf *pb = gdk_pixbuf_loader_get_pixbuf(loader);
+        if (pb) {
+            cairo_surface_t *s = surfaceFromPixbuf(pb);
+            name = writeIconSurface(s, "trayjs-svg");
+            cairo_surface_destroy(s);
+        }
+    }
+    g_object_unref(loader);
+    return name;
 }
 
 /* -----------------------------------------------------------------------
- * Command handlers (called on GTK main thread via g_idle_add)
+ * Render cache for vector and SVG sources, keyed by pixel size and source
  * ----------------------------------------------------------------------- */
-static gboolean processCmd(gpointer data) {
-    cJSON *m = (cJSON *)data;
-    const char *meth = cJSON_GetStringValue(cJSON_GetObjectItem(m, "method"));
-    cJSON *p = cJSON_GetObjectItem(m, "params");
-    if (!meth) { cJSON_Delete(m); return G_SOURCE_REMOVE; }
-
-    if (!strcmp(meth, "setMenu")) {
-        gBuildingMenu = TRUE;
-        GtkWidget *newMenu = gtk_menu_new();
-        cJSON *items = cJSON_GetObjectItem(p, "items");
-        if (items) buildMenuItems(GTK_MENU_SHELL(newMenu), items);
-        /* dbusmenu asserts if the menu has no children */
-        if (!gtk_container_get_children(GTK_CONTAINER(newMenu))) {
-            GtkWidget *ph = gtk_menu_item_new_with_label("");
-            gtk_widget_set_sensitive(ph, FALSE);
-            gtk_menu_shell_append(GTK_MENU_SHELL(newMenu), ph);
+typedef char *(*RenderFn)(const char *source, gsize len, int size);
+
+/* Returns the cached icon name for |source| at |size|, rendering on a miss. */
+static const char *renderedIcon(char kind, const char *source, gsize len, int size, RenderFn render) {
+    char *hash = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (const guchar *)source, len);
+    char *key = g_strdup_printf("%c%d\x1f%s", kind, size, hash);
+    g_free(hash);
+    const char *name = g_hash_table_lookup(gRenderCache, key);
+    if (name) { g_free(key); return name; }
+
+    char *rendered = render(source, len, size);
+    if (!rendered) { g_free(key); return NULL; }
+    if (g_hash_table_size(gRenderCache) >= ICON_CACHE_MAX)
+        evictIconCache(gRenderCache, TRUE);
+    g_hash_table_insert(gRenderCache, key, rendered);
+    return rendered;
+}
+
+/* -----------------------------------------------------------------------
+ * Sparkline
+ *
+ * Samples only land in the ring buffer; a one-shot timer renders the next
+ * frame no sooner than 1/fps after the previous one, so redraw cost is
+ * bounded by the frame rate and the helper stays idle between bursts.
+ * ----------------------------------------------------------------------- */
+static char *renderSparkline(Tray *t) {
+    int size = iconPixelSize();
+    cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    double lo = t->spark.min, hi = t->spark.max;
+    if (isnan(lo) || isnan(hi)) {
+        double dlo = INFINITY, dhi = -INFINITY;
+        for (int i = 0; i < t->spark.len; i++) {
+            dlo = MIN(dlo, t->spark.samples[i]);
+            dhi = MAX(dhi, t->spark.samples[i]);
         }
-        gtk_widget_show_all(newMenu);
-        gtk_widget_destroy(gMenu);
-        gMenu = newMenu;
-        app_indicator_set_menu(gIndicator, GTK_MENU(gMenu));
-        connectAboutToShow();
-        gBuildingMenu = FALSE;
-    } else if (!strcmp(meth, "setIcon")) {
-        const char *b64 = cJSON_GetStringValue(cJSON_GetObjectItem(p, "base64"));
-        if (b64) {
-            size_t len;
-            unsigned char *d = base64Decode(b64, &len);
-            if (d) {
-                char name[64];
-                snprintf(name, sizeof(name), "trayjs-icon-%d.png", ++gIconSeq);
-                char *path = g_build_filename(gIconDir, name, NULL);
-                g_file_set_contents(path, (const char *)d, len, NULL);
-                name[strlen(name) - 4] = '\0'; /* strip .png for icon name */
-                app_indicator_set_icon_full(gIndicator, name, "icon");
-                g_free(path);
-                free(d);
-            }
+        if (isnan(lo)) lo = dlo;
+        if (isnan(hi)) hi = dhi;
+    }
+    if (hi - lo < 1e-9) { hi += 0.5; lo -= 0.5; }
+
+    if (t->spark.len > 1) {
+        cairo_t *cr = cairo_create(s);
+        double step = (double)size / (t->spark.cap - 1), pad = size / 11.0;
+        double x0 = size - step * (t->spark.len - 1);
+        int first = (t->spark.head - t->spark.len + t->spark.cap) % t->spark.cap;
+        for (int i = 0; i < t->spark.len; i++) {
+            double v = CLAMP(t->spark.samples[(first + i) % t->spark.cap], lo, hi);
+            double y = size - pad - (v - lo) / (hi - lo) * (size - 2 * pad);
+            if (i) cairo_line_to(cr, x0 + i * step, y);
+            else cairo_move_to(cr, x0, y);
+        }
+        Paint *c = &t->spark.color;
+        cairo_set_source_rgba(cr, c->r, c->g, c->b, c->a);
+        cairo_set_line_width(cr, MAX(1.0, size / 14.0));
+        cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+        cairo_stroke_preserve(cr);
+        cairo_line_to(cr, size, size);
+        cairo_line_to(cr, x0, size);
+        cairo_close_path(cr);
+        cairo_set_source_rgba(cr, c->r, c->g, c->b, c->a * 0.35);
+        cairo_fill(cr);
+        cairo_destroy(cr);
+    }
+    char *name = writeIconSurface(s, "trayjs-spark");
+    cairo_surface_destroy(s);
+    return name;
+}
+
+static gboolean onSparkFrame(gpointer data) {
+    Tray *t = data;
+    t->spark.frameId = 0;
+    t->spark.lastFrame = g_get_monotonic_time();
+    char *name = renderSparkline(t);
+    if (!name) return G_SOURCE_REMOVE;
+    setBaseIcon(t, name);
+    /* Keep the previous frame on disk in case the shell is still loading it */
+    if (t->spark.frames[0]) {
+        unlinkIcon(t->spark.frames[0]);
+        g_free(t->spark.frames[0]);
+    }
+    t->spark.frames[0] = t->spark.frames[1];
+    t->spark.frames[1] = name;
+    return G_SOURCE_REMOVE;
+}
+
+static void scheduleSparkFrame(Tray *t) {
+    if (t->spark.frameId) return;
+    gint64 due = t->spark.lastFrame + G_USEC_PER_SEC / t->spark.fps;
+    gint64 delay = MAX(0, due - g_get_monotonic_time()) / 1000;
+    t->spark.frameId = g_timeout_add((guint)delay, onSparkFrame, t);
+}
+
+static void stopSparkline(Tray *t) {
+    if (!t->spark.on) return;
+    t->spark.on = FALSE;
+    if (t->spark.frameId) g_source_remove(t->spark.frameId);
+    t->spark.frameId = 0;
+}
+
+static void startSparkline(Tray *t, const ProtoSetSparkline *p) {
+    int cap = p->hasSamples ? CLAMP(p->samples, 2, 1024) : 32;
+    if (cap != t->spark.cap) {
+        g_free(t->spark.samples);
+        t->spark.samples = g_new0(double, cap);
+        t->spark.cap = cap;
+    }
+    t->spark.len = t->spark.head = 0;
+    t->spark.fps = p->hasFps ? CLAMP(p->fps, 1, 60) : 4;
+    t->spark.min = p->hasMin ? p->min : NAN;
+    t->spark.max = p->hasMax ? p->max : NAN;
+    const char *color = p->color;
+    if (!color || !parseColor(&color, &t->spark.color))
+        t->spark.color = (Paint){ 1, 1, 1, 1, TRUE };
+    t->spark.on = TRUE;
+    scheduleSparkFrame(t);
+}
+
+static void pushSample(Tray *t, double v) {
+    if (!t->spark.on) return;
+    t->spark.samples[t->spark.head] = v;
+    t->spark.head = (t->spark.head + 1) % t->spark.cap;
+    if (t->spark.len < t->spark.cap) t->spark.len++;
+    scheduleSparkFrame(t);
+}
+
+/* -----------------------------------------------------------------------
+ * Ticker
+ *
+ * A label or tooltip the helper updates itself: elapsed time since |from|,
+ * time left until |to|, or the wall clock when neither is given.  Each
+ * tick is scheduled for the exact moment the shown text changes, so Node
+ * stays idle and the display never lags.
+ *
+ * Durations understand %H (total hours), %M, %S and %%; the clock uses
+ * strftime.
+ * ----------------------------------------------------------------------- */
+static char *formatDuration(const char *fmt, gint64 seconds) {
+    GString *out = g_string_sized_new(32);
+    for (const char *c = fmt; *c; c++) {
+        if (*c != '%' || !c[1]) { g_string_append_c(out, *c); continue; }
+        switch (*++c) {
+        case 'H': g_string_append_printf(out, "%02" G_GINT64_FORMAT, seconds / 3600); break;
+        case 'M': g_string_append_printf(out, "%02d", (int)(seconds / 60 % 60)); break;
+        case 'S': g_string_append_printf(out, "%02d", (int)(seconds % 60)); break;
+        default:  g_string_append_c(out, *c); break;
+        }
+    }
+    return g_string_free(out, FALSE);
+}
+
+static char *tickerText(Tray *t, gint64 nowMs) {
+    if (t->ticker.from || t->ticker.to) {
+        gint64 ms = t->ticker.to ? MAX(0, t->ticker.to - nowMs) : MAX(0, nowMs - t->ticker.from);
+        /* A countdown shows 00:00:01 until it actually reaches zero */
+        return formatDuration(t->ticker.format, t->ticker.to ? (ms + 999) / 1000 : ms / 1000);
+    }
+    char buf[256];
+    time_t secs = nowMs / 1000;
+    struct tm tm;
+    localtime_r(&secs, &tm);
+    return g_strdup(strftime(buf, sizeof buf, t->ticker.format, &tm) ? buf : "");
+}
+
+static gboolean onTick(gpointer data) {
+    Tray *t = data;
+    gint64 now = g_get_real_time() / 1000;
+    char *text = tickerText(t, now);
+    setProp(t, t->ticker.prop, text);
+    g_free(text);
+    t->ticker.ticks++;
+    /* A countdown that has run out stays at zero; nothing left to tick */
+    if (t->ticker.to && now >= t->ticker.to) {
+        t->ticker.timerId = 0;
+        return G_SOURCE_REMOVE;
+    }
+    /* Next interval boundary relative to the reference time */
+    gint64 ref = t->ticker.to ? t->ticker.to : t->ticker.from;
+    gint64 phase = ((now - ref) % t->ticker.intervalMs + t->ticker.intervalMs) % t->ticker.intervalMs;
+    t->ticker.timerId = g_timeout_add((guint)(t->ticker.intervalMs - phase), onTick, t);
+    return G_SOURCE_REMOVE;
+}
+
+static void stopTicker(Tray *t) {
+    if (!t->ticker.on) return;
+    t->ticker.on = FALSE;
+    t->lines[PROTO_SLOT_TICKER] = 0;
+    if (t->ticker.timerId) g_source_remove(t->ticker.timerId);
+    t->ticker.timerId = 0;
+    g_clear_pointer(&t->ticker.format, g_free);
+}
+
+static void startTicker(Tray *t, const ProtoStartTicker *p) {
+    stopTicker(t);
+    t->ticker.from = p->hasFrom ? (gint64)p->from : 0;
+    t->ticker.to = p->hasTo ? (gint64)p->to : 0;
+    t->ticker.format = g_strdup(p->format ? p->format : t->ticker.from || t->ticker.to ? "%H:%M:%S" : "%H:%M");
+    gboolean seconds = strstr(t->ticker.format, "%S") || strstr(t->ticker.format, "%T");
+    t->ticker.intervalMs = p->hasInterval ? CLAMP(p->interval, 100, 3600000) : seconds ? 1000 : 60000;
+    t->ticker.prop = !g_strcmp0(p->target, "tooltip") ? PROP_TITLE : PROP_LABEL;
+    t->lines[t->ticker.prop == PROP_LABEL ? PROTO_SLOT_LABEL : PROTO_SLOT_TITLE] = 0;
+    if (t->ticker.prop == PROP_LABEL) {
+        /* Reserve the width of the widest digits */
+        char *guide = formatDuration(t->ticker.format, 88 * 3600 + 88 * 60 + 58);
+        g_free(t->label.guide);
+        t->label.guide = guide;
+    }
+    t->ticker.on = TRUE;
+    onTick(t);
+}
+
+/* -----------------------------------------------------------------------
+ * Icon files
+ *
+ * PNG files are symlinked into the icon directory so neither Node nor the
+ * helper reads more than their signature; SVG files are mapped and
+ * rasterized.  Other formats are refused: the link has to end in .png.  With watch,
+ * a file monitor (inotify) republishes the icon whenever the file changes.
+ * ----------------------------------------------------------------------- */
+static gboolean isPngFile(const char *path) {
+    static const guchar sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    guchar head[8];
+    FILE *f = fopen(path, "rb");
+    if (!f) return FALSE;
+    gboolean png = fread(head, 1, sizeof(head), f) == sizeof(head) && !memcmp(head, sig, sizeof(sig));
+    fclose(f);
+    return png;
+}
+
+static void loadIconFile(Tray *t, const char *path) {
+    if (g_str_has_suffix(path, ".svg")) {
+        GMappedFile *mf = g_mapped_file_new(path, FALSE, NULL);
+        if (!mf) return;
+        const char *name = renderedIcon('s', g_mapped_file_get_contents(mf),
+                                        g_mapped_file_get_length(mf), iconPixelSize(), renderSvg);
+        g_mapped_file_unref(mf);
+        if (name) setBaseIcon(t, name);
+        return;
+    }
+    if (!isPngFile(path)) {
+        fprintf(stderr, "trayjs: %s is neither PNG nor SVG\n", path);
+        return;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "trayjs-file-%d.png", ++gIconSeq);
+    char *target = g_canonicalize_filename(path, NULL);
+    char *link = g_build_filename(gIconDir, name, NULL);
+    if (!symlink(target, link)) {
+        name[strlen(name) - 4] = '\0';
+        setBaseIcon(t, name);
+        /* The shell may load the previous link until the new one is out */
+        if (t->iconFile.link) g_ptr_array_add(t->retired, t->iconFile.link);
+        t->iconFile.link = g_strdup(name);
+    }
+    g_free(link); g_free(target);
+}
+
+static gboolean onIconFileReload(gpointer data) {
+    Tray *t = data;
+    t->iconFile.reloadId = 0;
+    loadIconFile(t, t->iconFile.path);
+    return G_SOURCE_REMOVE;
+}
+
+static void onIconFileChanged(GFileMonitor *m, GFile *file, GFile *other,
+                              GFileMonitorEvent event, gpointer data) {
+    Tray *t = data;
+    if (event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+        event != G_FILE_MONITOR_EVENT_CREATED) return;
+    /* Writers often emit several events per update; reload once they settle */
+    if (!t->iconFile.reloadId)
+        t->iconFile.reloadId = g_timeout_add(50, onIconFileReload, t);
+}
+
+static void stopIconFile(Tray *t) {
+    if (t->iconFile.monitor) {
+        g_file_monitor_cancel(t->iconFile.monitor);
+        g_clear_object(&t->iconFile.monitor);
+    }
+    if (t->iconFile.reloadId) g_source_remove(t->iconFile.reloadId);
+    t->iconFile.reloadId = 0;
+    g_free(t->iconFile.path);
+    t->iconFile.path = NULL;
+}
+
+static void startIconFile(Tray *t, const char *path, gboolean watch) {
+    t->iconFile.path = g_strdup(path);
+    loadIconFile(t, path);
+    if (!watch) return;
+    GFile *f = g_file_new_for_path(path);
+    t->iconFile.monitor = g_file_monitor_file(f, G_FILE_MONITOR_NONE, NULL, NULL);
+    g_object_unref(f);
+    if (t->iconFile.monitor)
+        g_signal_connect(t->iconFile.monitor, "changed", G_CALLBACK(onIconFileChanged), t);
+}
+
+/* -----------------------------------------------------------------------
+ * Backend events
+ * ----------------------------------------------------------------------- */
+static void onActivated(void *user, const char *id) {
+    cJSON *p = cJSON_CreateObject();
+    cJSON_AddStringToObject(p, "id", id);
+    emit(user, "clicked", p);
+}
+
+static gboolean onMenuDeadline(gpointer data) {
+    Tray *t = data;
+    t->menuWait.timerId = 0;
+    t->menuWait.misses++;
+    gBackend->releaseAboutToShow(t->item, FALSE);
+    return G_SOURCE_REMOVE;
+}
+
+/* Shells call AboutToShow for the root, submenus and hovers of a single
+   open; only the first of a burst reaches Node. */
+static void requestMenu(Tray *t) {
+    gint64 now = g_get_monotonic_time(), since = now - t->menuReq.lastUs;
+    if ((t->menuReq.pending && since < MENU_PENDING_MAX_US) || since < t->menuReq.windowMs * 1000) {
+        t->menuReq.collapsed++;
+        return;
+    }
+    t->menuReq.pending = ++t->menuReq.seq;
+    t->menuReq.lastUs = now;
+    t->menuReq.emitted++;
+    cJSON *p = cJSON_CreateObject();
+    cJSON_AddNumberToObject(p, "requestId", t->menuReq.seq);
+    emit(t, "menuRequested", p);
+}
+
+static void onAboutToShow(void *user) {
+    Tray *t = user;
+    requestMenu(t);
+    if (!t->menuWait.deadlineMs || t->menuWait.timerId) return;
+    /* Nothing to wait for if the open was folded into an answered request */
+    if (t->menuReq.pending)
+        t->menuWait.timerId = g_timeout_add(t->menuWait.deadlineMs, onMenuDeadline, t);
+    else
+        gBackend->releaseAboutToShow(t->item, FALSE);
+}
+
+static gboolean flushScroll(gpointer data) {
+    Tray *t = data;
+    t->scroll.timerId = 0;
+    if (!t->scroll.count) return G_SOURCE_REMOVE;
+    t->scroll.last = g_get_monotonic_time();
+    t->scroll.sent++;
+    cJSON *p = cJSON_CreateObject();
+    cJSON_AddNumberToObject(p, "dx", t->scroll.dx);
+    cJSON_AddNumberToObject(p, "dy", t->scroll.dy);
+    cJSON_AddNumberToObject(p, "count", t->scroll.count);
+    cJSON_AddNumberToObject(p, "total", t->scroll.raw);
+    emit(t, "scrolled", p);
+    t->scroll.dx = t->scroll.dy = t->scroll.count = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void onScrolled(void *user, int dx, int dy) {
+    Tray *t = user;
+    t->scroll.dx += dx;
+    t->scroll.dy += dy;
+    t->scroll.count++;
+    t->scroll.raw++;
+    if (t->scroll.timerId) return;
+    gint64 wait = t->scroll.last + t->scroll.windowMs * 1000 - g_get_monotonic_time();
+    if (wait <= 0) flushScroll(t);
+    else t->scroll.timerId = g_timeout_add((guint)(wait / 1000) + 1, flushScroll, t);
+}
+
+/*
+ * Hosts query the menu right after they pick the item up.  Ask Node for
+ * the menu at that point; the host's query then folds into the same
+ * request, so the first real open already shows a live menu.
+ */
+static void onRegistered(void *user) {
+    Tray *t = user;
+    if (!t->registeredUs) t->registeredUs = g_get_monotonic_time() - t->createdUs;
+    t->registrations++;
+    requestMenu(t);
+}
+
+/* setMenu, or keepMenu when Node's menu is unchanged, answers a request
+   and releases a held AboutToShow */
+static void menuAnswered(Tray *t, gboolean hasRequestId, int requestId, gboolean changed) {
+    if (hasRequestId && (guint)requestId >= t->menuReq.pending) t->menuReq.pending = 0;
+    if (t->menuWait.timerId) {
+        g_source_remove(t->menuWait.timerId);
+        t->menuWait.timerId = 0;
+        t->menuWait.hits++;
+        gBackend->releaseAboutToShow(t->item, changed);
+    }
+}
+
+/* -----------------------------------------------------------------------
+ * Trays
+ *
+ * All items share the backend, the icon directory and its render cache,
+ * so an extra tray costs one backend item and its own timers: no process,
+ * toolkit or bus connection of its own.
+ * ----------------------------------------------------------------------- */
+static const TrayCallbacks kCallbacks = { onActivated, onAboutToShow, onRegistered, onScrolled };
+
+/* Shows item |id| with the default icon; NULL if the backend cannot */
+static Tray *trayNew(int id, const char *tooltip, int menuDeadlineMs, int menuWindowMs, int scrollWindowMs) {
+    Tray *t = g_new0(Tray, 1);
+    t->id = id;
+    t->createdUs = g_get_monotonic_time();
+    t->progress = -1;
+    t->label.maxRate = 10;
+    t->menuReq.windowMs = menuWindowMs;
+    t->scroll.windowMs = scrollWindowMs;
+    t->item = gBackend->create(gIconDir, "trayjs-default", tooltip, &kCallbacks, t);
+    if (!t->item) {
+        g_free(t);
+        return NULL;
+    }
+    if (gBackend->deferAboutToShow) t->menuWait.deadlineMs = menuDeadlineMs;
+    if (t->menuWait.deadlineMs) gBackend->deferAboutToShow(t->item, TRUE);
+    t->overlayCache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    t->retired = g_ptr_array_new_with_free_func(g_free);
+    t->baseIconName = g_strdup("trayjs-default");
+    initProps(t, "trayjs-default", tooltip);
+    g_hash_table_insert(gTrays, GINT_TO_POINTER(id), t);
+    return t;
+}
+
+/* gTrays' value destructor: removes the item and everything it scheduled */
+static void trayFree(gpointer data) {
+    Tray *t = data;
+    stopTicker(t);
+    stopSparkline(t);
+    stopIconFile(t);
+    if (t->menuWait.timerId) g_source_remove(t->menuWait.timerId);
+    if (t->props.flushId) g_source_remove(t->props.flushId);
+    if (t->label.timerId) g_source_remove(t->label.timerId);
+    if (t->scroll.timerId) g_source_remove(t->scroll.timerId);
+    gBackend->destroy(t->item);
+
+    evictIconCache(t->overlayCache, FALSE);
+    g_hash_table_unref(t->overlayCache);
+    for (guint i = 0; i < t->retired->len; i++) unlinkIcon(t->retired->pdata[i]);
+    g_ptr_array_unref(t->retired);
+    for (int i = 0; i < 2; i++) {
+        if (t->spark.frames[i]) unlinkIcon(t->spark.frames[i]);
+        g_free(t->spark.frames[i]);
+    }
+    if (t->iconFile.link) unlinkIcon(t->iconFile.link);
+    g_free(t->iconFile.link);
+    for (int i = 0; i < PROP_COUNT; i++) {
+        g_free(t->props.want[i]);
+        g_free(t->props.shown[i]);
+    }
+    g_clear_object(&t->baseIcon);
+    g_free(t->baseIconName); g_free(t->attentionIconName); g_free(t->badge);
+    g_free(t->spark.samples);
+    g_free(t->label.text); g_free(t->label.guide);
+    g_free(t);
+}
+
+/* |resumed|: the tray was shown before this client, which may skip the
+   lines it would repeat */
+static void emitReady(Tray *t, gboolean resumed) {
+    cJSON *ready = cJSON_CreateObject();
+    cJSON_AddNumberToObject(ready, "protocol", TRAYJS_PROTOCOL_VERSION);
+    cJSON_AddBoolToObject(ready, "svg", svgSupported());
+    if (resumed) {
+        cJSON_AddTrueToObject(ready, "resumed");
+        cJSON *state = cJSON_AddObjectToObject(ready, "state");
+        for (int i = PROTO_SLOT_NONE + 1; i < PROTO_SLOT_COUNT; i++) {
+            char hex[9];
+            if (!t->lines[i]) continue;
+            snprintf(hex, sizeof(hex), "%08x", t->lines[i]);
+            cJSON_AddStringToObject(state, proto_slot_name(i), hex);
         }
-    } else if (!strcmp(meth, "setTooltip")) {
-        const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(p, "text"));
-        if (text) app_indicator_set_title(gIndicator, text);
     }
+    emit(t, "ready", ready);
+}
+
+/* -----------------------------------------------------------------------
+ * Command handlers (called on GTK main thread via g_idle_add, with the
+ * addressed tray as |ctx|)
+ * ----------------------------------------------------------------------- */
+/* Publishes PNG data as a new icon file and returns its name */
+static char *iconFromPng(const void *data, size_t len) {
+    char *name = g_strdup_printf("trayjs-icon-%d", ++gIconSeq);
+    char *file = g_strdup_printf("%s.png", name);
+    char *path = g_build_filename(gIconDir, file, NULL);
+    g_file_set_contents(path, data, len, NULL);
+    g_free(path); g_free(file);
+    return name;
+}
+
+/* Resolves setIcon-style params (vector, svg or base64 PNG) to an icon name;
+   |size| <= 0 uses the panel's pixel size.  An SVG that does not render
+   (malformed, or no gdk-pixbuf SVG loader) falls back to the PNG if given. */
+static char *iconFromParams(const char *vector, const char *svg, const char *b64, int size) {
+    if (size <= 0) size = iconPixelSize();
+    if (vector) return g_strdup(renderedIcon('v', vector, strlen(vector), size, renderVector));
+    if (svg) {
+        const char *name = renderedIcon('s', svg, strlen(svg), size, renderSvg);
+        if (name || !b64) return g_strdup(name);
+    }
+    if (!b64) return NULL;
+    size_t len;
+    unsigned char *d = base64Decode(b64, &len);
+    if (!d) return NULL;
+    char *name = iconFromPng(d, len);
+    free(d);
+    return name;
+}
+
+/* Both take ownership of |name| */
+static void applyIcon(Tray *t, char *name) {
+    stopSparkline(t);
+    stopIconFile(t);
+    if (name) setBaseIcon(t, name);
+    g_free(name);
+}
+
+static void applyAttentionIcon(Tray *t, char *name) {
+    if (!name) return;
+    g_free(t->attentionIconName);
+    t->attentionIconName = name;
+    setProp(t, PROP_ATTENTION_ICON, name);
+}
+
+static void cmdSetMenu(void *ctx, const ProtoSetMenu *p) {
+    Tray *t = ctx;
+    gBackend->setMenu(t->item, p->items);
+    menuAnswered(t, p->hasRequestId, p->requestId, TRUE);
+}
+
+static void cmdKeepMenu(void *ctx, const ProtoKeepMenu *p) {
+    Tray *t = ctx;
+    t->menuReq.kept++;
+    menuAnswered(t, p->hasRequestId, p->requestId, FALSE);
+}
+
+/* Lets the client resend an SVG icon that did not render as PNG */
+static char *checkedIcon(Tray *t, char *name, const char *svg, gboolean attention) {
+    if (!name && svg) {
+        cJSON *params = cJSON_CreateObject();
+        cJSON_AddBoolToObject(params, "attention", attention);
+        emit(t, "iconFailed", params);
+    }
+    return name;
+}
+
+static void cmdSetIcon(void *ctx, const ProtoSetIcon *p) {
+    char *name = iconFromParams(p->vector, p->svg, p->base64, p->size);
+    applyIcon(ctx, checkedIcon(ctx, name, p->vector ? NULL : p->svg, FALSE));
+}
+
+static void cmdSetAttentionIcon(void *ctx, const ProtoSetAttentionIcon *p) {
+    char *name = iconFromParams(p->vector, p->svg, p->base64, p->size);
+    applyAttentionIcon(ctx, checkedIcon(ctx, name, p->vector ? NULL : p->svg, TRUE));
+}
+
+static void cmdSetStatus(void *ctx, const ProtoSetStatus *p) {
+    if (!g_strcmp0(p->status, "attention") || !g_strcmp0(p->status, "passive") || !g_strcmp0(p->status, "active"))
+        setProp(ctx, PROP_STATUS, p->status);
+}
+
+static void cmdSetTooltip(void *ctx, const ProtoSetTooltip *p) {
+    Tray *t = ctx;
+    if (!p->text) return;
+    if (t->ticker.prop == PROP_TITLE) stopTicker(t);
+    setProp(t, PROP_TITLE, p->text);
+}
+
+static void cmdSetLabel(void *ctx, const ProtoSetLabel *p) {
+    Tray *t = ctx;
+    if (t->ticker.prop == PROP_LABEL) stopTicker(t);
+    setLabel(t, p->text ? p->text : "", p->guide, p->hasMaxRate ? CLAMP(p->maxRate, 1, 60) : 0);
+}
+
+static void cmdStartTicker(void *ctx, const ProtoStartTicker *p) {
+    startTicker(ctx, p);
+}
+
+static void cmdStopTicker(void *ctx) {
+    stopTicker(ctx);
+}
+
+static void cmdSetIconFile(void *ctx, const ProtoSetIconFile *p) {
+    Tray *t = ctx;
+    if (!p->path) return;
+    stopSparkline(t);
+    stopIconFile(t);
+    startIconFile(t, p->path, p->watch);
+}
+
+static void cmdSetSparkline(void *ctx, const ProtoSetSparkline *p) {
+    stopIconFile(ctx);
+    startSparkline(ctx, p);
+}
+
+static void cmdPushSample(void *ctx, const ProtoPushSample *p) {
+    if (p->hasV) pushSample(ctx, p->v);
+}
 
-    cJSON_Delete(m);
+static void cmdSetBadge(void *ctx, const ProtoSetBadge *p) {
+    Tray *t = ctx;
+    if (!g_strcmp0(p->text, t->badge)) return;
+    g_free(t->badge);
+    t->badge = g_strdup(p->text);
+    publishIcon(t);
+}
+
+static void cmdSetProgress(void *ctx, const ProtoSetProgress *p) {
+    Tray *t = ctx;
+    int percent = p->hasValue && p->value >= 0 ? (int)lround(CLAMP(p->value, 0.0, 1.0) * 100) : -1;
+    if (percent == t->progress) return;
+    t->progress = percent;
+    publishIcon(t);
+}
+
+static void cmdGetStats(void *ctx) {
+    Tray *t = ctx;
+    cJSON *stats = cJSON_CreateObject();
+    cJSON_AddStringToObject(stats, "backend", gBackend->name);
+    cJSON_AddNumberToObject(stats, "trays", g_hash_table_size(gTrays));
+    cJSON_AddNumberToObject(stats, "registeredMs", t->registeredUs / 1000.0);
+    cJSON_AddNumberToObject(stats, "registrations", t->registrations);
+    cJSON_AddNumberToObject(stats, "menuWindowMs", t->menuReq.windowMs);
+    cJSON_AddNumberToObject(stats, "menuRequests", t->menuReq.emitted);
+    cJSON_AddNumberToObject(stats, "menuRequestsCollapsed", t->menuReq.collapsed);
+    cJSON_AddNumberToObject(stats, "menuKept", t->menuReq.kept);
+    cJSON_AddNumberToObject(stats, "menuDeadlineMs", t->menuWait.deadlineMs);
+    cJSON_AddNumberToObject(stats, "menuDeadlineHits", t->menuWait.hits);
+    cJSON_AddNumberToObject(stats, "menuDeadlineMisses", t->menuWait.misses);
+    cJSON_AddNumberToObject(stats, "propertyUpdates", t->props.updates);
+    cJSON_AddNumberToObject(stats, "labelRequests", t->label.updates);
+    cJSON_AddNumberToObject(stats, "tickerTicks", t->ticker.ticks);
+    cJSON_AddNumberToObject(stats, "scrollEvents", t->scroll.raw);
+    cJSON_AddNumberToObject(stats, "scrollEventsSent", t->scroll.sent);
+    cJSON_AddNumberToObject(stats, "propertiesPublished", t->props.published);
+    cJSON_AddNumberToObject(stats, "commands", gStats.commands);
+    cJSON_AddNumberToObject(stats, "unknownCommands", gStats.unknown);
+    cJSON_AddNumberToObject(stats, "dispatchUs", (double)gStats.dispatchUs);
+    pthread_mutex_lock(&gStatsLock);
+    cJSON_AddNumberToObject(stats, "bytesIn", (double)gStats.bytesIn);
+    cJSON_AddNumberToObject(stats, "parseUs", (double)gStats.parseUs);
+    pthread_mutex_unlock(&gStatsLock);
+#ifndef TRAYJS_ADDON
+    if (gDaemon.path) cJSON_AddNumberToObject(stats, "daemonClients", gDaemon.clients);
+#endif
+    if (gBackend->addStats) gBackend->addStats(t->item, stats);
+    emit(t, "stats", stats);
+}
+
+/* createTray on a tray that exists (a daemon's, shown before this client):
+   the options given replace its own, the rest stay */
+static void trayResume(Tray *t, const ProtoCreateTray *p) {
+    if (p->tooltip && g_strcmp0(p->tooltip, t->props.want[PROP_TITLE])) {
+        if (t->ticker.prop == PROP_TITLE) stopTicker(t);
+        setProp(t, PROP_TITLE, p->tooltip);
+        t->lines[PROTO_SLOT_TITLE] = 0;
+    }
+    if (p->hasMenuWindow) t->menuReq.windowMs = MAX(0, p->menuWindow);
+    if (p->hasScrollWindow) t->scroll.windowMs = MAX(0, p->scrollWindow);
+    if (p->hasMenuDeadline && gBackend->deferAboutToShow) {
+        t->menuWait.deadlineMs = MAX(0, p->menuDeadline);
+        gBackend->deferAboutToShow(t->item, t->menuWait.deadlineMs > 0);
+    }
+    emitReady(t, TRUE);
+}
+
+/* Unset createTray options fall back to the command line's */
+static void cmdCreateTray(void *ctx, const ProtoCreateTray *p) {
+    if (!p->hasId || p->id < 0) return;
+    Tray *t = g_hash_table_lookup(gTrays, GINT_TO_POINTER(p->id));
+    if (t) {
+        trayResume(t, p);
+        return;
+    }
+    t = trayNew(p->id, p->tooltip ? p->tooltip : "Tray",
+                      p->hasMenuDeadline ? MAX(0, p->menuDeadline) : gDefaults.menuDeadlineMs,
+                      p->hasMenuWindow ? MAX(0, p->menuWindow) : gDefaults.menuWindowMs,
+                      p->hasScrollWindow ? MAX(0, p->scrollWindow) : gDefaults.scrollWindowMs);
+    if (t) emitReady(t, FALSE);
+    else fprintf(stderr, "trayjs: cannot create tray %d\n", p->id);
+}
+
+static void cmdDestroyTray(void *ctx, const ProtoDestroyTray *p) {
+    Tray *t = p->hasId ? g_hash_table_lookup(gTrays, GINT_TO_POINTER(p->id)) : NULL;
+    if (!t) return;
+    emit(t, "closed", NULL);
+    g_hash_table_remove(gTrays, GINT_TO_POINTER(p->id));
+#ifndef TRAYJS_ADDON
+    /* A daemon runs until its last tray is removed */
+    if (gDaemon.path && !g_hash_table_size(gTrays)) g_main_loop_quit(gLoop);
+#endif
+}
+
+static const ProtoHandlers gCommands = {
+    .setMenu          = cmdSetMenu,
+    .keepMenu         = cmdKeepMenu,
+    .setIcon          = cmdSetIcon,
+    .setAttentionIcon = cmdSetAttentionIcon,
+    .setStatus        = cmdSetStatus,
+    .setTooltip       = cmdSetTooltip,
+    .setLabel         = cmdSetLabel,
+    .startTicker      = cmdStartTicker,
+    .stopTicker       = cmdStopTicker,
+    .setIconFile      = cmdSetIconFile,
+    .setSparkline     = cmdSetSparkline,
+    .pushSample       = cmdPushSample,
+    .setBadge         = cmdSetBadge,
+    .setProgress      = cmdSetProgress,
+    .getStats         = cmdGetStats,
+    .createTray       = cmdCreateTray,
+    .destroyTray      = cmdDestroyTray,
+};
+
+/* Addressed to a tray that does not exist (yet) */
+static const ProtoHandlers gUnboundCommands = {
+    .createTray       = cmdCreateTray,
+    .destroyTray      = cmdDestroyTray,
+};
+
+/* A parsed line on its way to the main loop */
+typedef struct {
+    cJSON    *msg;
+    uint32_t  digest;    /* proto_line_digest, 0 when not tracked */
+} QueuedCmd;
+
+static gboolean processCmd(gpointer data) {
+    QueuedCmd *q = data;
+    gint64 t0 = g_get_monotonic_time();
+    ProtoEnvelope env = {0};
+    proto_envelope(q->msg, &env);
+    Tray *t = g_hash_table_lookup(gTrays, GINT_TO_POINTER(env.tray));
+    ProtoCommand cmd = proto_dispatch(q->msg, t ? &gCommands : &gUnboundCommands, t);
+    if (cmd == PROTO_CMD_UNKNOWN) gStats.unknown++;
+    else if (t && q->digest && proto_command_slot(cmd)) t->lines[proto_command_slot(cmd)] = q->digest;
+    gStats.commands++;
+    gStats.dispatchUs += g_get_monotonic_time() - t0;
+    cJSON_Delete(q->msg);
+    g_free(q);
     return G_SOURCE_REMOVE;
 }
 
 /* -----------------------------------------------------------------------
- * Stdin reader thread
+ * Input: stdin reader thread, a daemon client, or the embedding addon
  * ----------------------------------------------------------------------- */
-static gboolean onStdinEof(gpointer data) {
-    app_indicator_set_status(gIndicator, APP_INDICATOR_STATUS_PASSIVE);
-    gtk_main_quit();
+#ifndef TRAYJS_ADDON
+static void daemonClientGone(FILE *in);
+#endif
+
+static gboolean onInputEnd(gpointer data) {
+#ifndef TRAYJS_ADDON
+    if (gDaemon.path) {
+        daemonClientGone(data);
+        return G_SOURCE_REMOVE;
+    }
+#endif
+    GHashTableIter it;
+    gpointer t;
+    g_hash_table_iter_init(&it, gTrays);
+    while (g_hash_table_iter_next(&it, NULL, &t)) {
+        setProp(t, PROP_STATUS, "passive");
+        flushProps(t);
+    }
+    g_main_loop_quit(gLoop);
+    return G_SOURCE_REMOVE;
+}
+
+/* Parses one line and queues it for the main loop; any thread */
+static void queueLine(const char *line, size_t len) {
+    gint64 t0 = g_get_monotonic_time();
+    cJSON *m = cJSON_ParseWithLength(line, len);
+    uint32_t digest = 0;
+#ifndef TRAYJS_ADDON
+    if (m && gDaemon.path) digest = proto_line_digest(line, len);
+#endif
+    pthread_mutex_lock(&gStatsLock);
+    gStats.bytesIn += len;
+    gStats.parseUs += g_get_monotonic_time() - t0;
+    pthread_mutex_unlock(&gStatsLock);
+    if (!m) return;
+    QueuedCmd *q = g_new(QueuedCmd, 1);
+    *q = (QueuedCmd){ m, digest };
+    g_idle_add(processCmd, q);
+}
+
+#ifdef TRAYJS_ADDON
+/* Lines from the addon are split and parsed on the main loop thread, so
+   the Node thread only copies them */
+static gboolean onAddonLines(gpointer data) {
+    char *buf = data;
+    for (const char *s = buf; *s; ) {
+        size_t n = strcspn(s, "\n");
+        if (n) queueLine(s, n);
+        s += n + (s[n] == '\n');
+    }
+    g_free(buf);
+    return G_SOURCE_REMOVE;
+}
+
+typedef struct {
+    int         tray;
+    const void *data;
+    size_t      len;
+    gboolean    attention;
+    void      (*done)(void *user);
+    void       *user;
+} AddonIcon;
+
+static gboolean onAddonIcon(gpointer data) {
+    AddonIcon *icon = data;
+    Tray *t = g_hash_table_lookup(gTrays, GINT_TO_POINTER(icon->tray));
+    char *name = t ? iconFromPng(icon->data, icon->len) : NULL;
+    icon->done(icon->user);
+    if (t && icon->attention) applyAttentionIcon(t, name);
+    else if (t) applyIcon(t, name);
+    g_free(icon);
     return G_SOURCE_REMOVE;
 }
 
-static void *stdinReader(void *arg) {
+void tray_core_command(char *lines) {
+    g_idle_add(onAddonLines, lines);
+}
+
+void tray_core_set_icon(int tray, const void *png, size_t len, gboolean attention,
+                        void (*done)(void *user), void *user) {
+    AddonIcon *icon = g_new(AddonIcon, 1);
+    *icon = (AddonIcon){ tray, png, len, attention, done, user };
+    g_idle_add(onAddonIcon, icon);
+}
+
+void tray_core_quit(void) {
+    g_idle_add(onInputEnd, NULL);
+}
+#else
+/* Reads stdin or a daemon client; onInputEnd gets the stream */
+static void *inputReader(void *arg) {
+    FILE *in = arg;
     char *line = NULL; size_t cap = 0; ssize_t len;
-    while ((len = getline(&line, &cap, stdin)) > 0) {
+    while ((len = getline(&line, &cap, in)) > 0) {
         if (line[len-1] == '\n') line[--len] = '\0';
         if (len == 0) continue;
-        cJSON *m = cJSON_Parse(line);
-        if (m) g_idle_add(processCmd, m);
+        queueLine(line, len);
     }
     free(line);
-    g_idle_add(onStdinEof, NULL);
+    g_idle_add(onInputEnd, in);
     return NULL;
 }
 
+static void startReader(FILE *in) {
+    pthread_t tid;
+    pthread_create(&tid, NULL, inputReader, in);
+    pthread_detach(tid);
+}
+
+/* -----------------------------------------------------------------------
+ * Daemon
+ *
+ * One client at a time: a new connection replaces the current one, which
+ * lets a restarted process take over before the old one is gone.  Between
+ * clients the trays stay as they are; events are dropped and held menu
+ * opens run into their deadline.
+ * ----------------------------------------------------------------------- */
+static gboolean socketAnswers(const struct sockaddr_un *addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    gboolean live = fd >= 0 && connect(fd, (const struct sockaddr *)addr, sizeof *addr) == 0;
+    if (fd >= 0) close(fd);
+    return live;
+}
+
+/* Listens on |path|, taking over a socket file left by a daemon that died;
+   fails while another daemon still answers there */
+static int daemonListen(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof addr.sun_path) return -1;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof addr) < 0
+        && (errno != EADDRINUSE || socketAnswers(&addr) || unlink(path) < 0
+            || bind(fd, (struct sockaddr *)&addr, sizeof addr) < 0)) {
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, 8) < 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+static void daemonDropClient(void) {
+    if (!gDaemon.out) return;
+    shutdown(fileno(gDaemon.out), SHUT_RDWR);   /* ends its reader too */
+    pthread_mutex_lock(&gOutputLock);
+    fclose(gDaemon.out);
+    gDaemon.out = NULL;
+    pthread_mutex_unlock(&gOutputLock);
+    gDaemon.in = NULL;
+}
+
+static gboolean onDaemonConnect(gint fd, GIOCondition cond, gpointer data) {
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) return G_SOURCE_CONTINUE;
+    int readFd = fcntl(client, F_DUPFD_CLOEXEC, 0);
+    if (readFd < 0 || fcntl(client, F_SETFD, FD_CLOEXEC) < 0) {
+        close(client);
+        if (readFd >= 0) close(readFd);
+        return G_SOURCE_CONTINUE;
+    }
+    daemonDropClient();
+    pthread_mutex_lock(&gOutputLock);
+    gDaemon.out = fdopen(client, "w");
+    pthread_mutex_unlock(&gOutputLock);
+    gDaemon.in = fdopen(readFd, "r");
+    gDaemon.clients++;
+    /* The client opens with createTray for each of its trays, tray 0
+       included, which resumes the tray as it was left or recreates it */
+    startReader(gDaemon.in);
+    return G_SOURCE_CONTINUE;
+}
+
+/* |in|'s reader has ended; the trays stay until the next client */
+static void daemonClientGone(FILE *in) {
+    if (in == gDaemon.in) daemonDropClient();
+    fclose(in);
+}
+
+static gboolean onDaemonSignal(gpointer data) {
+    g_main_loop_quit(gLoop);
+    return G_SOURCE_REMOVE;
+}
+#endif
+
 /* -----------------------------------------------------------------------
  * main
  * ----------------------------------------------------------------------- */
-int main(int argc, char **argv) {
-    gtk_init(&argc, &argv);
+static int run(int argc, char **argv) {
+    static const TrayBackend *const backends[] = {
+#ifdef TRAYJS_SNI
+        &traySniBackend,
+#else
+        &trayAppIndicatorBackend,
+#endif
+        &trayHeadlessBackend,
+    };
+    gStats.startUs = g_get_monotonic_time();
     initB64();
 
-    /* Create temp icon directory */
-    char tmpl[] = "/tmp/trayjs-icons-XXXXXX";
-    gIconDir = g_strdup(mkdtemp(tmpl));
+    gTrays = g_hash_table_new_full(NULL, NULL, NULL, trayFree);
+    gRenderCache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 
     /* Parse args */
-    const char *iconPath = NULL, *tooltip = "Tray";
+    const char *iconPath = NULL, *tooltip = "Tray", *backend = NULL;
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--icon") && i+1 < argc) iconPath = argv[++i];
         if (!strcmp(argv[i], "--tooltip") && i+1 < argc) tooltip = argv[++i];
+        if (!strcmp(argv[i], "--icon-size") && i+1 < argc) gIconSize = MAX(1, atoi(argv[++i]));
+        if (!strcmp(argv[i], "--backend") && i+1 < argc) backend = argv[++i];
+        if (!strcmp(argv[i], "--menu-deadline") && i+1 < argc) gDefaults.menuDeadlineMs = MAX(0, atoi(argv[++i]));
+        if (!strcmp(argv[i], "--menu-window") && i+1 < argc) gDefaults.menuWindowMs = MAX(0, atoi(argv[++i]));
+        if (!strcmp(argv[i], "--scroll-window") && i+1 < argc) gDefaults.scrollWindowMs = MAX(0, atoi(argv[++i]));
+#ifndef TRAYJS_ADDON
+        if (!strcmp(argv[i], "--daemon") && i+1 < argc) gDaemon.path = argv[++i];
+#endif
+    }
+    gBackend = backends[0];
+    for (gsize i = 0; backend && i < G_N_ELEMENTS(backends); i++)
+        if (!strcmp(backends[i]->name, backend)) gBackend = backends[i];
+    if (backend && strcmp(gBackend->name, backend)) {
+        fprintf(stderr, "trayjs: unknown backend '%s'\n", backend);
+        return 1;
     }
 
-    /* Create indicator */
-    gIndicator = app_indicator_new("trayjs", "trayjs-default",
-                                    APP_INDICATOR_CATEGORY_APPLICATION_STATUS);
-    app_indicator_set_icon_theme_path(gIndicator, gIconDir);
-    app_indicator_set_status(gIndicator, APP_INDICATOR_STATUS_ACTIVE);
-    app_indicator_set_title(gIndicator, tooltip);
-
-    /* Set icon */
-    if (iconPath) {
-        gchar *data; gsize len;
-        if (g_file_get_contents(iconPath, &data, &len, NULL)) {
-            char *dest = g_build_filename(gIconDir, "trayjs-custom.png", NULL);
-            g_file_set_contents(dest, data, len, NULL);
-            g_free(data); g_free(dest);
-            app_indicator_set_icon_full(gIndicator, "trayjs-custom", "icon");
-        }
-    } else {
-        writeDefaultIcon();
+#ifndef TRAYJS_ADDON
+    /* Listen before the backend starts, so a client can connect meanwhile */
+    if (gDaemon.path && (gDaemon.listenFd = daemonListen(gDaemon.path)) < 0) {
+        fprintf(stderr, "trayjs: cannot listen on %s: %s\n", gDaemon.path,
+                errno == EADDRINUSE ? "a daemon is already running" : g_strerror(errno));
+        return 1;
     }
+#endif
+
+    /* Create temp icon directory */
+    char tmpl[] = "/tmp/trayjs-icons-XXXXXX";
+    gIconDir = g_strdup(mkdtemp(tmpl));
+    writeDefaultIcon();
 
-    /* Create menu – must contain at least one item or libdbusmenu
-       will reject it with assertion failures. */
-    gMenu = gtk_menu_new();
-    GtkWidget *ph = gtk_menu_item_new_with_label("");
-    gtk_widget_set_sensitive(ph, FALSE);
-    gtk_menu_shell_append(GTK_MENU_SHELL(gMenu), ph);
-    gtk_widget_show_all(gMenu);
-    app_indicator_set_menu(gIndicator, GTK_MENU(gMenu));
+    /* Create tray 0 */
+    Tray *t = NULL;
+    if (!gBackend->init(&argc, &argv) ||
+        !(t = trayNew(0, tooltip, gDefaults.menuDeadlineMs, gDefaults.menuWindowMs, gDefaults.scrollWindowMs))) {
+        fprintf(stderr, "trayjs: cannot start the %s backend\n", gBackend->name);
+        unlinkIcon("trayjs-default");
+        g_rmdir(gIconDir);
+        return 1;
+    }
+    t->createdUs = gStats.startUs;   /* its registeredMs includes startup */
 
-    /* Defer hooking about-to-show so the shell's initial AboutToShow
-       query (fired during indicator registration) is ignored. */
-    g_timeout_add(200, deferredConnectAboutToShow, NULL);
+    /* Set icon */
+    if (iconPath) loadIconFile(t, iconPath);
 
-    emit("ready", NULL);
+    emitReady(t, FALSE);
 
-    /* Start stdin reader */
-    pthread_t tid;
-    pthread_create(&tid, NULL, stdinReader, NULL);
+#ifndef TRAYJS_ADDON
+    if (gDaemon.path) {
+        /* Clients come and go; a dead one must not take the daemon along */
+        signal(SIGPIPE, SIG_IGN);
+        g_unix_fd_add(gDaemon.listenFd, G_IO_IN, onDaemonConnect, NULL);
+        g_unix_signal_add(SIGTERM, onDaemonSignal, NULL);
+        g_unix_signal_add(SIGINT, onDaemonSignal, NULL);
+    } else {
+        startReader(stdin);
+    }
+#endif
 
-    gtk_main();
+    gLoop = g_main_loop_new(NULL, FALSE);
+    g_main_loop_run(gLoop);
+    g_hash_table_destroy(gTrays);
+#ifndef TRAYJS_ADDON
+    if (gDaemon.path) {
+        daemonDropClient();
+        close(gDaemon.listenFd);
+        unlink(gDaemon.path);
+    }
+#endif
 
     /* Cleanup temp icons */
     GDir *dir = g_dir_open(gIconDir, 0, NULL);
@@ -333,3 +1786,14 @@ int main(int argc, char **argv) {
 
     return 0;
 }
+
+#ifdef TRAYJS_ADDON
+int tray_core_run(int argc, char **argv, void (*emitLine)(char *line)) {
+    gEmitLine = emitLine;
+    return run(argc, argv);
+}
+#else
+int main(int argc, char **argv) {
+    return run(argc, argv);
+}
+#endif
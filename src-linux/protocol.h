@@ -0,0 +1,219 @@
+/*
+ * Generated by scripts/gen-protocol.mjs from protocol/protocol.json. Do not edit.
+ *
+ * Command decoder for the JSON-lines protocol.  Decoding walks each parsed
+ * message once and allocates nothing: strings and json fields point into
+ * the cJSON tree and stay valid until it is deleted.  Absent or mistyped
+ * fields decode as NULL / 0 with their has-flag cleared.
+ */
+
+#ifndef TRAYJS_PROTOCOL_H
+#define TRAYJS_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+
+#define TRAYJS_PROTOCOL_VERSION 2
+
+typedef enum {
+    PROTO_CMD_UNKNOWN = -1,
+    PROTO_CMD_SET_MENU,
+    PROTO_CMD_KEEP_MENU,
+    PROTO_CMD_SET_ICON,
+    PROTO_CMD_SET_ATTENTION_ICON,
+    PROTO_CMD_SET_STATUS,
+    PROTO_CMD_SET_TOOLTIP,
+    PROTO_CMD_SET_LABEL,
+    PROTO_CMD_START_TICKER,
+    PROTO_CMD_STOP_TICKER,
+    PROTO_CMD_SET_ICON_FILE,
+    PROTO_CMD_SET_SPARKLINE,
+    PROTO_CMD_PUSH_SAMPLE,
+    PROTO_CMD_SET_BADGE,
+    PROTO_CMD_SET_PROGRESS,
+    PROTO_CMD_GET_STATS,
+    PROTO_CMD_CREATE_TRAY,
+    PROTO_CMD_DESTROY_TRAY,
+    PROTO_CMD_COUNT
+} ProtoCommand;
+
+/* Part of what a tray shows; the commands of a slot replace each other */
+typedef enum {
+    PROTO_SLOT_NONE,
+    PROTO_SLOT_MENU,
+    PROTO_SLOT_ICON,
+    PROTO_SLOT_ATTENTION_ICON,
+    PROTO_SLOT_STATUS,
+    PROTO_SLOT_TITLE,
+    PROTO_SLOT_LABEL,
+    PROTO_SLOT_TICKER,
+    PROTO_SLOT_BADGE,
+    PROTO_SLOT_PROGRESS,
+    PROTO_SLOT_COUNT
+} ProtoSlot;
+
+/* Fields next to method and params */
+typedef struct {
+    int tray;
+    int hasTray;
+} ProtoEnvelope;
+
+/* Replaces the menu; answers menu request |requestId| if given. */
+typedef struct {
+    cJSON *items;
+    int requestId;
+    int hasRequestId;
+} ProtoSetMenu;
+
+/* Answers menu request |requestId| without changing the menu. */
+typedef struct {
+    int requestId;
+    int hasRequestId;
+} ProtoKeepMenu;
+
+/* Sets the icon from a vector drawing, SVG source or base64 PNG/ICO. */
+typedef struct {
+    const char *base64;
+    const char *svg;
+    const char *vector;
+    int size;
+    int hasSize;
+} ProtoSetIcon;
+
+/* Preloads the icon shown while the status is attention. */
+typedef struct {
+    const char *base64;
+    const char *svg;
+    const char *vector;
+    int size;
+    int hasSize;
+} ProtoSetAttentionIcon;
+
+/* Sets the item status: passive, active or attention. */
+typedef struct {
+    const char *status;
+} ProtoSetStatus;
+
+/* Sets the tooltip (the item title on Linux). */
+typedef struct {
+    const char *text;
+} ProtoSetTooltip;
+
+/* Sets the label next to the icon, republished at most |maxRate| times per second. */
+typedef struct {
+    const char *text;
+    int maxRate;
+    int hasMaxRate;
+    const char *guide;
+} ProtoSetLabel;
+
+/* Starts a helper-driven clock, elapsed time or countdown. */
+typedef struct {
+    const char *format;
+    double from;
+    int hasFrom;
+    double to;
+    int hasTo;
+    int interval;
+    int hasInterval;
+    const char *target;
+} ProtoStartTicker;
+
+/* Shows a PNG or SVG file as the icon, optionally republishing it when it changes. */
+typedef struct {
+    const char *path;
+    int watch;
+} ProtoSetIconFile;
+
+/* Switches the icon to a sparkline of the pushed samples. */
+typedef struct {
+    int samples;
+    int hasSamples;
+    int fps;
+    int hasFps;
+    double min;
+    int hasMin;
+    double max;
+    int hasMax;
+    const char *color;
+} ProtoSetSparkline;
+
+/* Appends a sample to the sparkline. */
+typedef struct {
+    double v;
+    int hasV;
+} ProtoPushSample;
+
+/* Draws |text| as a badge over the icon; null removes it. */
+typedef struct {
+    const char *text;
+} ProtoSetBadge;
+
+/* Draws a progress bar (0..1) over the icon; null removes it. */
+typedef struct {
+    double value;
+    int hasValue;
+} ProtoSetProgress;
+
+/* Shows another tray item |id| from this process, or applies the options given to an existing one (a daemon's); answered with its ready event. */
+typedef struct {
+    int id;
+    int hasId;
+    const char *tooltip;
+    int menuDeadline;
+    int hasMenuDeadline;
+    int menuWindow;
+    int hasMenuWindow;
+    int scrollWindow;
+    int hasScrollWindow;
+} ProtoCreateTray;
+
+/* Removes tray item |id|; answered with its closed event. */
+typedef struct {
+    int id;
+    int hasId;
+} ProtoDestroyTray;
+
+/* One handler per command, called with the |ctx| given to proto_dispatch;
+   NULL handlers are ignored like unknown methods */
+typedef struct {
+    void (*setMenu)(void *ctx, const ProtoSetMenu *p);
+    void (*keepMenu)(void *ctx, const ProtoKeepMenu *p);
+    void (*setIcon)(void *ctx, const ProtoSetIcon *p);
+    void (*setAttentionIcon)(void *ctx, const ProtoSetAttentionIcon *p);
+    void (*setStatus)(void *ctx, const ProtoSetStatus *p);
+    void (*setTooltip)(void *ctx, const ProtoSetTooltip *p);
+    void (*setLabel)(void *ctx, const ProtoSetLabel *p);
+    void (*startTicker)(void *ctx, const ProtoStartTicker *p);
+    void (*stopTicker)(void *ctx);
+    void (*setIconFile)(void *ctx, const ProtoSetIconFile *p);
+    void (*setSparkline)(void *ctx, const ProtoSetSparkline *p);
+    void (*pushSample)(void *ctx, const ProtoPushSample *p);
+    void (*setBadge)(void *ctx, const ProtoSetBadge *p);
+    void (*setProgress)(void *ctx, const ProtoSetProgress *p);
+    void (*getStats)(void *ctx);
+    void (*createTray)(void *ctx, const ProtoCreateTray *p);
+    void (*destroyTray)(void *ctx, const ProtoDestroyTray *p);
+} ProtoHandlers;
+
+/* Method name to command, PROTO_CMD_UNKNOWN if there is none */
+ProtoCommand proto_command(const char *name, size_t len);
+
+/* Slot whose shown state |cmd| replaces, and its name in ready's state */
+ProtoSlot   proto_command_slot(ProtoCommand cmd);
+const char *proto_slot_name(ProtoSlot slot);
+
+/* FNV-1a of a command line without its envelope fields, as lineDigest()
+   computes it for the line before they were added */
+uint32_t proto_line_digest(const char *line, size_t len);
+
+/* Decodes the envelope fields of |msg| */
+void proto_envelope(const cJSON *msg, ProtoEnvelope *out);
+
+/* Decodes |msg| ({method, params}) and calls its handler.  Returns the
+   command, or PROTO_CMD_UNKNOWN when nothing was called. */
+ProtoCommand proto_dispatch(const cJSON *msg, const ProtoHandlers *handlers, void *ctx);
+
+#endif
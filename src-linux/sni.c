@@ -0,0 +1,637 @@
+/*
+ * StatusNotifierItem + com.canonical.dbusmenu over plain GDBus.
+ *
+ * Implements the parts of both specs that shells actually use:
+ *   https://www.freedesktop.org/wiki/Specifications/StatusNotifierItem/
+ *   libdbusmenu's com.canonical.dbusmenu interface (version 3)
+ * The item registers with org.kde.StatusNotifierWatcher and re-registers
+ * whenever the watcher restarts.  Each item has a bus connection of its
+ * own, so every item sits at the standard paths and the watcher drops it
+ * as soon as that connection closes.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "sni.h"
+#include "tray.h"
+
+#define SNI_PATH  "/StatusNotifierItem"
+#define MENU_PATH "/MenuBar"
+#define SNI_IFACE  "org.kde.StatusNotifierItem"
+#define MENU_IFACE "com.canonical.dbusmenu"
+#define WATCHER_NAME "org.kde.StatusNotifierWatcher"
+
+static const char kIntrospection[] =
+    "<node>"
+    " <interface name='org.kde.StatusNotifierItem'>"
+    "  <property name='Category' type='s' access='read'/>"
+    "  <property name='Id' type='s' access='read'/>"
+    "  <property name='Title' type='s' access='read'/>"
+    "  <property name='Status' type='s' access='read'/>"
+    "  <property name='WindowId' type='i' access='read'/>"
+    "  <property name='IconThemePath' type='s' access='read'/>"
+    "  <property name='IconName' type='s' access='read'/>"
+    "  <property name='IconPixmap' type='a(iiay)' access='read'/>"
+    "  <property name='OverlayIconName' type='s' access='read'/>"
+    "  <property name='OverlayIconPixmap' type='a(iiay)' access='read'/>"
+    "  <property name='AttentionIconName' type='s' access='read'/>"
+    "  <property name='AttentionIconPixmap' type='a(iiay)' access='read'/>"
+    "  <property name='AttentionMovieName' type='s' access='read'/>"
+    "  <property name='ToolTip' type='(sa(iiay)ss)' access='read'/>"
+    "  <property name='ItemIsMenu' type='b' access='read'/>"
+    "  <property name='Menu' type='o' access='read'/>"
+    "  <property name='XAyatanaLabel' type='s' access='read'/>"
+    "  <property name='XAyatanaLabelGuide' type='s' access='read'/>"
+    "  <method name='ContextMenu'><arg name='x' type='i' direction='in'/><arg name='y' type='i' direction='in'/></method>"
+    "  <method name='Activate'><arg name='x' type='i' direction='in'/><arg name='y' type='i' direction='in'/></method>"
+    "  <method name='SecondaryActivate'><arg name='x' type='i' direction='in'/><arg name='y' type='i' direction='in'/></method>"
+    "  <method name='Scroll'><arg name='delta' type='i' direction='in'/><arg name='orientation' type='s' direction='in'/></method>"
+    "  <signal name='NewTitle'/>"
+    "  <signal name='NewIcon'/>"
+    "  <signal name='NewAttentionIcon'/>"
+    "  <signal name='NewOverlayIcon'/>"
+    "  <signal name='NewToolTip'/>"
+    "  <signal name='NewStatus'><arg name='status' type='s'/></signal>"
+    "  <signal name='XAyatanaNewLabel'><arg name='label' type='s'/><arg name='guide' type='s'/></signal>"
+    " </interface>"
+    " <interface name='com.canonical.dbusmenu'>"
+    "  <property name='Version' type='u' access='read'/>"
+    "  <property name='TextDirection' type='s' access='read'/>"
+    "  <property name='Status' type='s' access='read'/>"
+    "  <property name='IconThemePath' type='as' access='read'/>"
+    "  <method name='GetLayout'>"
+    "   <arg type='i' name='parentId' direction='in'/>"
+    "   <arg type='i' name='recursionDepth' direction='in'/>"
+    "   <arg type='as' name='propertyNames' direction='in'/>"
+    "   <arg type='u' name='revision' direction='out'/>"
+    "   <arg type='(ia{sv}av)' name='layout' direction='out'/>"
+    "  </method>"
+    "  <method name='GetGroupProperties'>"
+    "   <arg type='ai' name='ids' direction='in'/>"
+    "   <arg type='as' name='propertyNames' direction='in'/>"
+    "   <arg type='a(ia{sv})' name='properties' direction='out'/>"
+    "  </method>"
+    "  <method name='GetProperty'>"
+    "   <arg type='i' name='id' direction='in'/>"
+    "   <arg type='s' name='name' direction='in'/>"
+    "   <arg type='v' name='value' direction='out'/>"
+    "  </method>"
+    "  <method name='Event'>"
+    "   <arg type='i' name='id' direction='in'/>"
+    "   <arg type='s' name='eventId' direction='in'/>"
+    "   <arg type='v' name='data' direction='in'/>"
+    "   <arg type='u' name='timestamp' direction='in'/>"
+    "  </method>"
+    "  <method name='EventGroup'>"
+    "   <arg type='a(isvu)' name='events' direction='in'/>"
+    "   <arg type='ai' name='idErrors' direction='out'/>"
+    "  </method>"
+    "  <method name='AboutToShow'>"
+    "   <arg type='i' name='id' direction='in'/>"
+    "   <arg type='b' name='needUpdate' direction='out'/>"
+    "  </method>"
+    "  <method name='AboutToShowGroup'>"
+    "   <arg type='ai' name='ids' direction='in'/>"
+    "   <arg type='ai' name='updatesNeeded' direction='out'/>"
+    "   <arg type='ai' name='idErrors' direction='out'/>"
+    "  </method>"
+    "  <signal name='ItemsPropertiesUpdated'>"
+    "   <arg type='a(ia{sv})' name='updatedProps'/>"
+    "   <arg type='a(ias)' name='removedProps'/>"
+    "  </signal>"
+    "  <signal name='LayoutUpdated'>"
+    "   <arg type='u' name='revision'/>"
+    "   <arg type='i' name='parent'/>"
+    "  </signal>"
+    "  <signal name='ItemActivationRequested'>"
+    "   <arg type='i' name='id'/>"
+    "   <arg type='u' name='timestamp'/>"
+    "  </signal>"
+    " </interface>"
+    "</node>";
+
+/* Menu node; ids index SniItem.nodes, the root is id 0 */
+typedef struct {
+    int        id;
+    char      *trayId;
+    char      *label;
+    gboolean   separator, enabled, checked;
+    GPtrArray *children;   /* MenuNode*, owned by SniItem.nodes */
+} MenuNode;
+
+struct SniItem {
+    GDBusConnection *conn;
+    GDBusNodeInfo   *info;
+    SniCallbacks     cb;
+    void            *user;
+    char            *id, *busName, *iconThemePath;
+    GCancellable    *registering;
+    char            *title, *iconName, *attentionIconName;
+    char            *label, *labelGuide;
+    SniStatus        status;
+    guint            objectIds[2], ownerId, watcherId;
+    gboolean         nameAcquired, watcherPresent;
+    GPtrArray       *nodes;
+    guint32          revision;
+    gboolean         deferAboutToShow;
+    GPtrArray       *heldAboutToShow;   /* GDBusMethodInvocation* awaiting a menu */
+    guint            signals;           /* emitted so far, for getStats */
+};
+
+static const char *statusString(SniStatus s) {
+    switch (s) {
+    case SNI_STATUS_PASSIVE: return "Passive";
+    case SNI_STATUS_NEEDS_ATTENTION: return "NeedsAttention";
+    default: return "Active";
+    }
+}
+
+static void emitSignal(SniItem *it, const char *path, const char *iface,
+                       const char *name, GVariant *params) {
+    g_dbus_connection_emit_signal(it->conn, NULL, path, iface, name, params, NULL);
+    it->signals++;
+}
+
+/* -----------------------------------------------------------------------
+ * Menu model
+ * ----------------------------------------------------------------------- */
+static void nodeFree(gpointer p) {
+    MenuNode *n = p;
+    g_free(n->trayId);
+    g_free(n->label);
+    g_ptr_array_unref(n->children);
+    g_free(n);
+}
+
+static MenuNode *nodeNew(SniItem *it) {
+    MenuNode *n = g_new0(MenuNode, 1);
+    n->id = it->nodes->len;
+    n->enabled = TRUE;
+    n->children = g_ptr_array_new();
+    g_ptr_array_add(it->nodes, n);
+    return n;
+}
+
+/* dbusmenu labels use '_' for mnemonics; keep titles literal */
+static char *escapeMnemonic(const char *s) {
+    GString *out = g_string_sized_new(strlen(s) + 4);
+    for (; *s; s++) {
+        if (*s == '_') g_string_append_c(out, '_');
+        g_string_append_c(out, *s);
+    }
+    return g_string_free(out, FALSE);
+}
+
+static void buildNodes(SniItem *it, MenuNode *parent, cJSON *items) {
+    int n = cJSON_GetArraySize(items);
+    for (int i = 0; i < n; i++) {
+        cJSON *cfg = cJSON_GetArrayItem(items, i);
+        MenuNode *node = nodeNew(it);
+        g_ptr_array_add(parent->children, node);
+        if (cJSON_IsTrue(cJSON_GetObjectItem(cfg, "separator"))) {
+            node->separator = TRUE;
+            continue;
+        }
+        node->label = escapeMnemonic(cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "title")) ?: "");
+        node->trayId = g_strdup(cJSON_GetStringValue(cJSON_GetObjectItem(cfg, "id")) ?: "");
+        node->enabled = !cJSON_IsFalse(cJSON_GetObjectItem(cfg, "enabled"));
+        node->checked = cJSON_IsTrue(cJSON_GetObjectItem(cfg, "checked"));
+        cJSON *jChildren = cJSON_GetObjectItem(cfg, "items");
+        if (cJSON_IsArray(jChildren)) buildNodes(it, node, jChildren);
+    }
+}
+
+static MenuNode *findNode(SniItem *it, int id) {
+    return id >= 0 && (guint)id < it->nodes->len ? g_ptr_array_index(it->nodes, id) : NULL;
+}
+
+static gboolean wantProperty(const char *const *names, const char *name) {
+    if (!names || !names[0]) return TRUE;
+    for (; *names; names++)
+        if (!strcmp(*names, name)) return TRUE;
+    return FALSE;
+}
+
+/* Only non-default properties are sent, as the dbusmenu spec allows */
+static GVariant *nodeProperties(MenuNode *n, const char *const *names) {
+    GVariantBuilder b;
+    g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+    if (n->separator) {
+        if (wantProperty(names, "type"))
+            g_variant_builder_add(&b, "{sv}", "type", g_variant_new_string("separator"));
+    } else if (n->id != 0) {
+        if (wantProperty(names, "label"))
+            g_variant_builder_add(&b, "{sv}", "label", g_variant_new_string(n->label));
+        if (!n->enabled && wantProperty(names, "enabled"))
+            g_variant_builder_add(&b, "{sv}", "enabled", g_variant_new_boolean(FALSE));
+        if (n->checked) {
+            if (wantProperty(names, "toggle-type"))
+                g_variant_builder_add(&b, "{sv}", "toggle-type", g_variant_new_string("checkmark"));
+            if (wantProperty(names, "toggle-state"))
+                g_variant_builder_add(&b, "{sv}", "toggle-state", g_variant_new_int32(1));
+        }
+    }
+    if (n->children->len && wantProperty(names, "children-display"))
+        g_variant_builder_add(&b, "{sv}", "children-display", g_variant_new_string("submenu"));
+    return g_variant_builder_end(&b);
+}
+
+static GVariant *nodeLayout(MenuNode *n, int depth, const char *const *names) {
+    GVariantBuilder children;
+    g_variant_builder_init(&children, G_VARIANT_TYPE("av"));
+    if (depth != 0)
+        for (guint i = 0; i < n->children->len; i++)
+            g_variant_builder_add(&children, "v",
+                nodeLayout(g_ptr_array_index(n->children, i), depth > 0 ? depth - 1 : -1, names));
+    return g_variant_new("(i@a{sv}av)", n->id, nodeProperties(n, names), &children);
+}
+
+static void activateNode(SniItem *it, int id) {
+    MenuNode *n = findNode(it, id);
+    if (n && !n->separator && !n->children->len && n->enabled && n->trayId && *n->trayId)
+        it->cb.activated(it->user, n->trayId);
+}
+
+/* -----------------------------------------------------------------------
+ * com.canonical.dbusmenu
+ * ----------------------------------------------------------------------- */
+static void menuMethodCall(GDBusConnection *conn, const gchar *sender, const gchar *path,
+                           const gchar *iface, const gchar *method, GVariant *params,
+                           GDBusMethodInvocation *inv, gpointer data) {
+    SniItem *it = data;
+    if (!strcmp(method, "GetLayout")) {
+        gint32 parentId, depth;
+        const gchar **names;
+        g_variant_get(params, "(ii^a&s)", &parentId, &depth, &names);
+        MenuNode *n = findNode(it, parentId);
+        if (n)
+            g_dbus_method_invocation_return_value(inv,
+                g_variant_new("(u@(ia{sv}av))", it->revision, nodeLayout(n, depth, names)));
+        else
+            g_dbus_method_invocation_return_error(inv, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                                  "Unknown item %d", parentId);
+        g_free(names);
+    } else if (!strcmp(method, "GetGroupProperties")) {
+        GVariantIter *ids;
+        const gchar **names;
+        gint32 id;
+        g_variant_get(params, "(ai^a&s)", &ids, &names);
+        GVariantBuilder b;
+        g_variant_builder_init(&b, G_VARIANT_TYPE("a(ia{sv})"));
+        while (g_variant_iter_next(ids, "i", &id)) {
+            MenuNode *n = findNode(it, id);
+            if (n) g_variant_builder_add(&b, "(i@a{sv})", id, nodeProperties(n, names));
+        }
+        g_dbus_method_invocation_return_value(inv, g_variant_new("(a(ia{sv}))", &b));
+        g_variant_iter_free(ids);
+        g_free(names);
+    } else if (!strcmp(method, "GetProperty")) {
+        gint32 id;
+        const gchar *name;
+        g_variant_get(params, "(i&s)", &id, &name);
+        MenuNode *n = findNode(it, id);
+        GVariant *props = n ? g_variant_ref_sink(nodeProperties(n, NULL)) : NULL;
+        GVariant *value = props ? g_variant_lookup_value(props, name, NULL) : NULL;
+        if (value)
+            g_dbus_method_invocation_return_value(inv, g_variant_new("(v)", value));
+        else
+            g_dbus_method_invocation_return_error(inv, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                                                  "Unknown property %s on item %d", name, id);
+        if (value) g_variant_unref(value);
+        if (props) g_variant_unref(props);
+    } else if (!strcmp(method, "Event")) {
+        gint32 id;
+        const gchar *eventId;
+        g_variant_get(params, "(i&svu)", &id, &eventId, NULL, NULL);
+        if (!strcmp(eventId, "clicked")) activateNode(it, id);
+        g_dbus_method_invocation_return_value(inv, NULL);
+    } else if (!strcmp(method, "EventGroup")) {
+        GVariantIter *events;
+        gint32 id;
+        const gchar *eventId;
+        GVariantBuilder errors;
+        g_variant_builder_init(&errors, G_VARIANT_TYPE("ai"));
+        g_variant_get(params, "(a(isvu))", &events);
+        while (g_variant_iter_loop(events, "(i&svu)", &id, &eventId, NULL, NULL)) {
+            if (!findNode(it, id)) g_variant_builder_add(&errors, "i", id);
+            else if (!strcmp(eventId, "clicked")) activateNode(it, id);
+        }
+        g_variant_iter_free(events);
+        g_dbus_method_invocation_return_value(inv, g_variant_new("(ai)", &errors));
+    } else if (!strcmp(method, "AboutToShow")) {
+        gint32 id;
+        g_variant_get(params, "(i)", &id);
+        if (id == 0 && it->deferAboutToShow) {
+            /* Answered by sni_item_release_about_to_show() */
+            g_ptr_array_add(it->heldAboutToShow, inv);
+            it->cb.aboutToShow(it->user);
+            return;
+        }
+        if (id == 0) it->cb.aboutToShow(it->user);
+        g_dbus_method_invocation_return_value(inv, g_variant_new("(b)", FALSE));
+    } else if (!strcmp(method, "AboutToShowGroup")) {
+        GVariantIter *ids;
+        gint32 id;
+        gboolean root = FALSE;
+        g_variant_get(params, "(ai)", &ids);
+        while (g_variant_iter_next(ids, "i", &id)) root |= id == 0;
+        g_variant_iter_free(ids);
+        if (root) it->cb.aboutToShow(it->user);
+        g_dbus_method_invocation_return_value(inv, g_variant_new("(aiai)", NULL, NULL));
+    } else {
+        g_dbus_method_invocation_return_error(inv, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+                                              "Unknown method %s", method);
+    }
+}
+
+static GVariant *menuGetProperty(GDBusConnection *conn, const gchar *sender, const gchar *path,
+                                 const gchar *iface, const gchar *prop, GError **error,
+                                 gpointer data) {
+    if (!strcmp(prop, "Version")) return g_variant_new_uint32(3);
+    if (!strcmp(prop, "TextDirection")) return g_variant_new_string("ltr");
+    if (!strcmp(prop, "Status")) return g_variant_new_string("normal");
+    if (!strcmp(prop, "IconThemePath")) return g_variant_new("as", NULL);
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property %s", prop);
+    return NULL;
+}
+
+/* -----------------------------------------------------------------------
+ * org.kde.StatusNotifierItem
+ * ----------------------------------------------------------------------- */
+static void itemMethodCall(GDBusConnection *conn, const gchar *sender, const gchar *path,
+                           const gchar *iface, const gchar *method, GVariant *params,
+                           GDBusMethodInvocation *inv, gpointer data) {
+    SniItem *it = data;
+    if (!strcmp(method, "Scroll")) {
+        gint32 delta;
+        const gchar *orientation;
+        g_variant_get(params, "(i&s)", &delta, &orientation);
+        if (!g_ascii_strcasecmp(orientation, "horizontal")) it->cb.scrolled(it->user, delta, 0);
+        else it->cb.scrolled(it->user, 0, delta);
+    }
+    /* ItemIsMenu is set, so shells open the menu themselves */
+    g_dbus_method_invocation_return_value(inv, NULL);
+}
+
+static GVariant *emptyPixmaps(void) {
+    return g_variant_new("a(iiay)", NULL);
+}
+
+static GVariant *itemGetProperty(GDBusConnection *conn, const gchar *sender, const gchar *path,
+                                 const gchar *iface, const gchar *prop, GError **error,
+                                 gpointer data) {
+    SniItem *it = data;
+    if (!strcmp(prop, "Category")) return g_variant_new_string("ApplicationStatus");
+    if (!strcmp(prop, "Id")) return g_variant_new_string(it->id);
+    if (!strcmp(prop, "Title")) return g_variant_new_string(it->title ?: "");
+    if (!strcmp(prop, "Status")) return g_variant_new_string(statusString(it->status));
+    if (!strcmp(prop, "WindowId")) return g_variant_new_int32(0);
+    if (!strcmp(prop, "IconThemePath")) return g_variant_new_string(it->iconThemePath);
+    if (!strcmp(prop, "IconName")) return g_variant_new_string(it->iconName ?: "");
+    if (!strcmp(prop, "AttentionIconName")) return g_variant_new_string(it->attentionIconName ?: "");
+    if (!strcmp(prop, "OverlayIconName") || !strcmp(prop, "AttentionMovieName"))
+        return g_variant_new_string("");
+    if (g_str_has_suffix(prop, "Pixmap")) return emptyPixmaps();
+    if (!strcmp(prop, "ToolTip"))
+        return g_variant_new("(s@a(iiay)ss)", "", emptyPixmaps(), it->title ?: "", "");
+    if (!strcmp(prop, "ItemIsMenu")) return g_variant_new_boolean(TRUE);
+    if (!strcmp(prop, "Menu")) return g_variant_new_object_path(MENU_PATH);
+    if (!strcmp(prop, "XAyatanaLabel")) return g_variant_new_string(it->label ?: "");
+    if (!strcmp(prop, "XAyatanaLabelGuide")) return g_variant_new_string(it->labelGuide ?: "");
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property %s", prop);
+    return NULL;
+}
+
+static const GDBusInterfaceVTable kItemVTable = { itemMethodCall, itemGetProperty, NULL };
+static const GDBusInterfaceVTable kMenuVTable = { menuMethodCall, menuGetProperty, NULL };
+
+/* -----------------------------------------------------------------------
+ * Watcher registration
+ * ----------------------------------------------------------------------- */
+static void onRegistered(GObject *source, GAsyncResult *res, gpointer data) {
+    SniItem *it = data;
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, NULL);
+    if (!reply) return;   /* also when cancelled, |it| may be gone */
+    g_variant_unref(reply);
+    it->cb.registered(it->user);
+}
+
+static void registerWithWatcher(SniItem *it) {
+    if (!it->nameAcquired || !it->watcherPresent) return;
+    g_dbus_connection_call(it->conn, WATCHER_NAME, "/StatusNotifierWatcher", WATCHER_NAME,
+                           "RegisterStatusNotifierItem", g_variant_new("(s)", it->busName),
+                           NULL, G_DBUS_CALL_FLAGS_NONE, -1, it->registering, onRegistered, it);
+}
+
+static void onNameAcquired(GDBusConnection *conn, const gchar *name, gpointer data) {
+    SniItem *it = data;
+    it->nameAcquired = TRUE;
+    registerWithWatcher(it);
+}
+
+static void onWatcherAppeared(GDBusConnection *conn, const gchar *name,
+                              const gchar *owner, gpointer data) {
+    SniItem *it = data;
+    it->watcherPresent = TRUE;
+    registerWithWatcher(it);
+}
+
+static void onWatcherVanished(GDBusConnection *conn, const gchar *name, gpointer data) {
+    SniItem *it = data;
+    it->watcherPresent = FALSE;
+}
+
+/* -----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------- */
+/* A private session bus connection: watchers track an item by the owner
+   of its name, so on the shared one a destroyed item would stay listed
+   until the process exits */
+static GDBusConnection *openConnection(void) {
+    char *address = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SESSION, NULL, NULL);
+    if (!address) return NULL;
+    GDBusConnection *conn = g_dbus_connection_new_for_address_sync(address,
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, NULL);
+    g_free(address);
+    return conn;
+}
+
+SniItem *sni_item_new(const char *id, const char *iconThemePath,
+                      const SniCallbacks *cb, void *user) {
+    GDBusConnection *conn = openConnection();
+    if (!conn) return NULL;
+
+    static int seq;
+    SniItem *it = g_new0(SniItem, 1);
+    it->conn = conn;
+    it->cb = *cb;
+    it->user = user;
+    it->id = g_strdup(id);
+    it->iconThemePath = g_strdup(iconThemePath);
+    it->status = SNI_STATUS_ACTIVE;
+    it->busName = g_strdup_printf("org.kde.StatusNotifierItem-%d-%d", (int)getpid(), ++seq);
+    it->registering = g_cancellable_new();
+    it->nodes = g_ptr_array_new_with_free_func(nodeFree);
+    it->heldAboutToShow = g_ptr_array_new();
+    nodeNew(it);
+
+    it->info = g_dbus_node_info_new_for_xml(kIntrospection, NULL);
+    it->objectIds[0] = g_dbus_connection_register_object(conn, SNI_PATH,
+        g_dbus_node_info_lookup_interface(it->info, SNI_IFACE), &kItemVTable, it, NULL, NULL);
+    it->objectIds[1] = g_dbus_connection_register_object(conn, MENU_PATH,
+        g_dbus_node_info_lookup_interface(it->info, MENU_IFACE), &kMenuVTable, it, NULL, NULL);
+    it->ownerId = g_bus_own_name_on_connection(conn, it->busName, G_BUS_NAME_OWNER_FLAGS_NONE,
+                                               onNameAcquired, NULL, it, NULL);
+    it->watcherId = g_bus_watch_name_on_connection(conn, WATCHER_NAME, G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                   onWatcherAppeared, onWatcherVanished, it, NULL);
+    return it;
+}
+
+void sni_item_free(SniItem *it) {
+    /* Hosts hide it now rather than when the watcher notices it is gone */
+    sni_item_set_status(it, SNI_STATUS_PASSIVE);
+    g_cancellable_cancel(it->registering);
+    g_object_unref(it->registering);
+    sni_item_release_about_to_show(it, FALSE);
+    g_ptr_array_unref(it->heldAboutToShow);
+    g_bus_unwatch_name(it->watcherId);
+    g_bus_unown_name(it->ownerId);
+    for (int i = 0; i < 2; i++)
+        g_dbus_connection_unregister_object(it->conn, it->objectIds[i]);
+    g_dbus_connection_close_sync(it->conn, NULL, NULL);   /* flushes first */
+    g_dbus_node_info_unref(it->info);
+    g_ptr_array_unref(it->nodes);
+    g_object_unref(it->conn);
+    g_free(it->id); g_free(it->busName); g_free(it->iconThemePath);
+    g_free(it->title); g_free(it->iconName); g_free(it->attentionIconName);
+    g_free(it->label); g_free(it->labelGuide);
+    g_free(it);
+}
+
+void sni_item_set_icon(SniItem *it, const char *name) {
+    if (!g_strcmp0(it->iconName, name)) return;
+    g_free(it->iconName);
+    it->iconName = g_strdup(name);
+    emitSignal(it, SNI_PATH, SNI_IFACE, "NewIcon", NULL);
+}
+
+void sni_item_set_attention_icon(SniItem *it, const char *name) {
+    if (!g_strcmp0(it->attentionIconName, name)) return;
+    g_free(it->attentionIconName);
+    it->attentionIconName = g_strdup(name);
+    emitSignal(it, SNI_PATH, SNI_IFACE, "NewAttentionIcon", NULL);
+}
+
+void sni_item_set_title(SniItem *it, const char *title) {
+    if (!g_strcmp0(it->title, title)) return;
+    g_free(it->title);
+    it->title = g_strdup(title);
+    emitSignal(it, SNI_PATH, SNI_IFACE, "NewTitle", NULL);
+    emitSignal(it, SNI_PATH, SNI_IFACE, "NewToolTip", NULL);
+}
+
+/* Ayatana extension: text shown next to the icon by hosts that support it */
+void sni_item_set_label(SniItem *it, const char *label, const char *guide) {
+    if (!g_strcmp0(it->label, label) && !g_strcmp0(it->labelGuide, guide)) return;
+    g_free(it->label); g_free(it->labelGuide);
+    it->label = g_strdup(label);
+    it->labelGuide = g_strdup(guide);
+    emitSignal(it, SNI_PATH, SNI_IFACE, "XAyatanaNewLabel",
+               g_variant_new("(ss)", label ?: "", guide ?: ""));
+}
+
+void sni_item_set_status(SniItem *it, SniStatus status) {
+    if (it->status == status) return;
+    it->status = status;
+    emitSignal(it, SNI_PATH, SNI_IFACE, "NewStatus", g_variant_new("(s)", statusString(status)));
+}
+
+void sni_item_set_defer_about_to_show(SniItem *it, gboolean defer) {
+    it->deferAboutToShow = defer;
+    if (!defer) sni_item_release_about_to_show(it, FALSE);
+}
+
+void sni_item_release_about_to_show(SniItem *it, gboolean needUpdate) {
+    for (guint i = 0; i < it->heldAboutToShow->len; i++)
+        g_dbus_method_invocation_return_value(it->heldAboutToShow->pdata[i],
+                                              g_variant_new("(b)", needUpdate));
+    g_ptr_array_set_size(it->heldAboutToShow, 0);
+}
+
+guint sni_item_signal_count(SniItem *it) {
+    return it->signals;
+}
+
+void sni_item_set_menu(SniItem *it, cJSON *items) {
+    g_ptr_array_set_size(it->nodes, 0);
+    MenuNode *root = nodeNew(it);
+    if (cJSON_IsArray(items)) buildNodes(it, root, items);
+    emitSignal(it, MENU_PATH, MENU_IFACE, "LayoutUpdated", g_variant_new("(ui)", ++it->revision, 0));
+}
+
+/* -----------------------------------------------------------------------
+ * Tray backend
+ * ----------------------------------------------------------------------- */
+/* SniItem is the backend's TrayItem */
+#define SNI(item) ((SniItem *)(item))
+
+static gboolean sniInit(int *argc, char ***argv) {
+    GDBusConnection *conn = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, NULL);
+    if (!conn) return FALSE;
+    g_object_unref(conn);   /* items open their own; this only checks for a bus */
+    return TRUE;
+}
+
+static TrayItem *sniCreate(const char *iconThemePath, const char *icon, const char *title,
+                           const TrayCallbacks *cb, void *user) {
+    static int seq;
+    SniCallbacks sniCb = { cb->activated, cb->aboutToShow, cb->registered, cb->scrolled };
+    char *id = seq++ ? g_strdup_printf("trayjs-%d", seq) : g_strdup("trayjs");
+    SniItem *it = sni_item_new(id, iconThemePath, &sniCb, user);
+    g_free(id);
+    if (!it) return NULL;
+    sni_item_set_icon(it, icon);
+    sni_item_set_title(it, title);
+    return (TrayItem *)it;
+}
+
+static void sniDestroy(TrayItem *item) { sni_item_free(SNI(item)); }
+static void sniSetIcon(TrayItem *item, const char *name) { sni_item_set_icon(SNI(item), name); }
+static void sniSetAttentionIcon(TrayItem *item, const char *name) { sni_item_set_attention_icon(SNI(item), name); }
+static void sniSetTitle(TrayItem *item, const char *title) { sni_item_set_title(SNI(item), title); }
+static void sniSetMenu(TrayItem *item, cJSON *items) { sni_item_set_menu(SNI(item), items); }
+static void sniSetLabel(TrayItem *item, const char *label, const char *guide) { sni_item_set_label(SNI(item), label, guide); }
+static void sniDeferAboutToShow(TrayItem *item, gboolean defer) { sni_item_set_defer_about_to_show(SNI(item), defer); }
+static void sniReleaseAboutToShow(TrayItem *item, gboolean needUpdate) { sni_item_release_about_to_show(SNI(item), needUpdate); }
+
+static void sniAddStats(TrayItem *item, cJSON *stats) {
+    cJSON_AddNumberToObject(stats, "signals", sni_item_signal_count(SNI(item)));
+}
+
+static void sniSetStatus(TrayItem *item, TrayStatus status) {
+    static const SniStatus map[] = {
+        [TRAY_STATUS_PASSIVE]   = SNI_STATUS_PASSIVE,
+        [TRAY_STATUS_ACTIVE]    = SNI_STATUS_ACTIVE,
+        [TRAY_STATUS_ATTENTION] = SNI_STATUS_NEEDS_ATTENTION,
+    };
+    sni_item_set_status(SNI(item), map[status]);
+}
+
+const TrayBackend traySniBackend = {
+    .name             = "sni",
+    .init             = sniInit,
+    .create           = sniCreate,
+    .destroy          = sniDestroy,
+    .setIcon          = sniSetIcon,
+    .setAttentionIcon = sniSetAttentionIcon,
+    .setTitle         = sniSetTitle,
+    .setStatus        = sniSetStatus,
+    .setMenu          = sniSetMenu,
+    .setLabel         = sniSetLabel,
+    .scaleFactor      = tray_env_scale_factor,
+    .addStats         = sniAddStats,
+    .deferAboutToShow   = sniDeferAboutToShow,
+    .releaseAboutToShow = sniReleaseAboutToShow,
+};
@@ -0,0 +1,50 @@
+/*
+ * StatusNotifierItem + com.canonical.dbusmenu over plain GDBus.
+ * Drop-in for the subset of AppIndicator the tray helper uses, without
+ * GTK: icons are published by name from an icon theme path and the menu
+ * is served straight from the protocol's JSON items.
+ */
+
+#ifndef TRAYJS_SNI_H
+#define TRAYJS_SNI_H
+
+#include <gio/gio.h>
+
+#include "cJSON.h"
+
+typedef struct SniItem SniItem;
+
+typedef enum {
+    SNI_STATUS_PASSIVE,
+    SNI_STATUS_ACTIVE,
+    SNI_STATUS_NEEDS_ATTENTION,
+} SniStatus;
+
+/* Each gets the |user| passed to sni_item_new */
+typedef struct {
+    void (*activated)(void *user, const char *id);   /* leaf menu item clicked */
+    void (*aboutToShow)(void *user);                 /* root menu about to open */
+    void (*registered)(void *user);                  /* watcher accepted the item */
+    void (*scrolled)(void *user, int dx, int dy);    /* Scroll(); > 0 is right/down */
+} SniCallbacks;
+
+/* Each item opens its own session bus connection and owns a bus name
+   there, so freeing it removes it from the watcher. */
+SniItem *sni_item_new(const char *id, const char *iconThemePath,
+                      const SniCallbacks *cb, void *user);
+void     sni_item_free(SniItem *item);
+
+void sni_item_set_icon(SniItem *item, const char *name);
+void sni_item_set_attention_icon(SniItem *item, const char *name);
+void sni_item_set_title(SniItem *item, const char *title);
+void sni_item_set_status(SniItem *item, SniStatus status);
+void sni_item_set_label(SniItem *item, const char *label, const char *guide);
+void sni_item_set_menu(SniItem *item, cJSON *items);
+guint sni_item_signal_count(SniItem *item);
+
+/* While deferred, root AboutToShow calls are held until released; the
+   reply's needUpdate tells the host to refetch the layout first. */
+void sni_item_set_defer_about_to_show(SniItem *item, gboolean defer);
+void sni_item_release_about_to_show(SniItem *item, gboolean needUpdate);
+
+#endif
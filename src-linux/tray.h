@@ -0,0 +1,83 @@
+/*
+ * Backend interface between the protocol core (main.c) and whatever
+ * actually shows the tray item.  The core owns parsing, icon rendering
+ * and scheduling; a backend only publishes the resulting state.
+ *
+ * All functions are called on the main loop thread.
+ */
+
+#ifndef TRAYJS_TRAY_H
+#define TRAYJS_TRAY_H
+
+#include <glib.h>
+
+#include "cJSON.h"
+
+typedef enum {
+    TRAY_STATUS_PASSIVE,
+    TRAY_STATUS_ACTIVE,
+    TRAY_STATUS_ATTENTION,
+} TrayStatus;
+
+/* One shown item; each backend defines it, the core only passes it back */
+typedef struct TrayItem TrayItem;
+
+/* Events a backend reports back to the core, with the item's |user| */
+typedef struct {
+    void (*activated)(void *user, const char *id);   /* leaf menu item clicked */
+    void (*aboutToShow)(void *user);                 /* root menu about to open */
+    void (*registered)(void *user);                  /* a tray host picked the item up */
+    void (*scrolled)(void *user, int dx, int dy);    /* wheel over the icon; > 0 is right/down */
+} TrayCallbacks;
+
+typedef struct {
+    const char *name;                    /* value accepted by --backend */
+
+    /* Process-wide setup before the first item.  Returns FALSE if the
+       backend cannot run here. */
+    gboolean (*init)(int *argc, char ***argv);
+
+    /* Icons are published by name from |iconThemePath|; |icon| already
+       exists there.  Returns NULL if the item cannot be shown. */
+    TrayItem *(*create)(const char *iconThemePath, const char *icon, const char *title,
+                        const TrayCallbacks *cb, void *user);
+    void (*destroy)(TrayItem *item);
+
+    void (*setIcon)(TrayItem *item, const char *name);
+    void (*setAttentionIcon)(TrayItem *item, const char *name);
+    void (*setTitle)(TrayItem *item, const char *title);
+    void (*setStatus)(TrayItem *item, TrayStatus status);
+    void (*setMenu)(TrayItem *item, cJSON *items);   /* protocol MenuItem[]; may be NULL */
+    void (*setLabel)(TrayItem *item, const char *label, const char *guide);   /* guide: widest expected text */
+
+    int  (*scaleFactor)(void);           /* device pixels per logical pixel */
+    void (*addStats)(TrayItem *item, cJSON *stats);   /* optional, adds backend counters */
+
+    /* Optional: hold the host's root AboutToShow call after aboutToShow()
+       until releaseAboutToShow(), so it can wait for a fresh menu. */
+    void (*deferAboutToShow)(TrayItem *item, gboolean defer);
+    void (*releaseAboutToShow)(TrayItem *item, gboolean needUpdate);
+} TrayBackend;
+
+extern const TrayBackend trayAppIndicatorBackend;
+extern const TrayBackend traySniBackend;
+extern const TrayBackend trayHeadlessBackend;
+
+/* GDK_SCALE, for backends without a display connection */
+int tray_env_scale_factor(void);
+
+#ifdef TRAYJS_ADDON
+/* Embedding (addon.c).  tray_core_run() runs the core on the calling
+   thread until tray_core_quit(); |emitLine| receives each event line
+   (malloc'd, without newline) on that thread and must free it.  The
+   other functions may be called from any thread. */
+int  tray_core_run(int argc, char **argv, void (*emitLine)(char *line));
+void tray_core_command(char *lines);     /* g_malloc'd JSON lines; takes ownership */
+/* Publishes |png| as the icon or attention icon of |tray|; |done| runs on
+   the core thread once the data is no longer needed. */
+void tray_core_set_icon(int tray, const void *png, size_t len, gboolean attention,
+                        void (*done)(void *user), void *user);
+void tray_core_quit(void);
+#endif
+
+#endif
@@ -1,7 +1,7 @@
 /*
  * Native Windows tray helper – JSON-lines stdin/stdout protocol.
  * Build (MSVC): 
- * cl /O2 /DUNICODE /D_UNICODE main.c cJSON.c /link /SUBSYSTEM:WINDOWS user32.lib shell32.lib gdi32.lib kernel32.lib
+ * cl /O2 /DUNICODE /D_UNICODE main.c protocol.c cJSON.c /link /SUBSYSTEM:WINDOWS user32.lib shell32.lib gdi32.lib kernel32.lib
  */
 
 #ifndef UNICODE
@@ -22,6 +22,7 @@
 #include <fcntl.h>
 
 #include "cJSON.h"
+#include "protocol.h"
 
 /* -----------------------------------------------------------------------
  * Constants & Macros
@@ -185,6 +186,47 @@ static void buildMenuItems(HMENU menu, cJSON *items) {
     }
 }
 
+/* -----------------------------------------------------------------------
+ * Command handlers
+ * ----------------------------------------------------------------------- */
+static void cmdSetMenu(void *ctx, const ProtoSetMenu *p) {
+    if (gMenu) DestroyMenu(gMenu);
+    gMenu = CreatePopupMenu(); gMenuIdCount = 0; gNextCmdId = 1;
+    buildMenuItems(gMenu, p->items);
+}
+
+static void cmdSetIcon(void *ctx, const ProtoSetIcon *p) {
+    if (!p->base64) return;
+    size_t len; unsigned char *d = base64Decode(p->base64, &len);
+    if (d) {
+        WCHAR tmpPath[MAX_PATH], tmpFile[MAX_PATH];
+        GetTempPathW(MAX_PATH, tmpPath);
+        GetTempFileNameW(tmpPath, L"ico", 0, tmpFile);
+        HANDLE hf = CreateFileW(tmpFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hf != INVALID_HANDLE_VALUE) {
+            DWORD w; WriteFile(hf, d, (DWORD)len, &w, NULL); CloseHandle(hf);
+            HICON n = (HICON)LoadImageW(NULL, tmpFile, IMAGE_ICON, 0, 0, LR_LOADFROMFILE | LR_DEFAULTSIZE);
+            if (n) { if (gIcon) DestroyIcon(gIcon); gIcon = n; gNid.hIcon = gIcon; Shell_NotifyIconW(NIM_MODIFY, &gNid); }
+            DeleteFileW(tmpFile);
+        }
+        free(d);
+    }
+}
+
+static void cmdSetTooltip(void *ctx, const ProtoSetTooltip *p) {
+    if (!p->text) return;
+    MultiByteToWideChar(CP_UTF8, 0, p->text, -1, gNid.szTip, MAX_TOOLTIP);
+    Shell_NotifyIconW(NIM_MODIFY, &gNid);
+}
+
+/* Commands without a handler are Linux-only and ignored, as are tray ids:
+   this helper shows one item */
+static const ProtoHandlers gCommands = {
+    .setMenu    = cmdSetMenu,
+    .setIcon    = cmdSetIcon,
+    .setTooltip = cmdSetTooltip,
+};
+
 static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     if (msg == gTaskbarCreatedMsg) { Shell_NotifyIconW(NIM_ADD, &gNid); return 0; }
     switch (msg) {
@@ -209,31 +251,7 @@ static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
         }
         case WM_STDIN_CMD: {
             cJSON *m = (cJSON *)lParam;
-            const char *meth = cJSON_GetStringValue(cJSON_GetObjectItem(m, "method"));
-            cJSON *p = cJSON_GetObjectItem(m, "params");
-            if (!strcmp(meth, "setMenu")) {
-                if (gMenu) DestroyMenu(gMenu);
-                gMenu = CreatePopupMenu(); gMenuIdCount = 0; gNextCmdId = 1;
-                buildMenuItems(gMenu, cJSON_GetObjectItem(p, "items"));
-            } else if (!strcmp(meth, "setIcon")) {
-                size_t len; unsigned char *d = base64Decode(cJSON_GetStringValue(cJSON_GetObjectItem(p, "base64")), &len);
-                if (d) {
-                    WCHAR tmpPath[MAX_PATH], tmpFile[MAX_PATH];
-                    GetTempPathW(MAX_PATH, tmpPath);
-                    GetTempFileNameW(tmpPath, L"ico", 0, tmpFile);
-                    HANDLE hf = CreateFileW(tmpFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-                    if (hf != INVALID_HANDLE_VALUE) {
-                        DWORD w; WriteFile(hf, d, (DWORD)len, &w, NULL); CloseHandle(hf);
-                        HICON n = (HICON)LoadImageW(NULL, tmpFile, IMAGE_ICON, 0, 0, LR_LOADFROMFILE | LR_DEFAULTSIZE);
-                        if (n) { if (gIcon) DestroyIcon(gIcon); gIcon = n; gNid.hIcon = gIcon; Shell_NotifyIconW(NIM_MODIFY, &gNid); }
-                        DeleteFileW(tmpFile);
-                    }
-                    free(d);
-                }
-            } else if (!strcmp(meth, "setTooltip")) {
-                MultiByteToWideChar(CP_UTF8, 0, cJSON_GetStringValue(cJSON_GetObjectItem(p, "text")), -1, gNid.szTip, MAX_TOOLTIP);
-                Shell_NotifyIconW(NIM_MODIFY, &gNid);
-            }
+            proto_dispatch(m, &gCommands, NULL);
             cJSON_Delete(m); break;
         }
         case WM_DESTROY: 
@@ -279,7 +297,9 @@ int WINAPI wWinMain(HINSTANCE hi, HINSTANCE hp, LPWSTR lp, int n) {
     
     gTaskbarCreatedMsg = RegisterWindowMessageW(L"TaskbarCreated");
     _beginthreadex(NULL, 0, stdinReaderThread, NULL, 0, NULL);
-    emit("ready", NULL);
+    cJSON *ready = cJSON_CreateObject();
+    cJSON_AddNumberToObject(ready, "protocol", TRAYJS_PROTOCOL_VERSION);
+    emit("ready", ready);
 
     MSG msg; while (GetMessage(&msg, NULL, 0, 0)) { TranslateMessage(&msg); DispatchMessage(&msg); }
     return 0;
@@ -0,0 +1,465 @@
+/*
+ * Generated by scripts/gen-protocol.mjs from protocol/protocol.json. Do not edit.
+ */
+
+#include <string.h>
+
+#include "protocol.h"
+
+ProtoCommand proto_command(const char *name, size_t len) {
+    switch (len) {
+    case 7:
+        if (!memcmp(name, "setMenu", 7)) return PROTO_CMD_SET_MENU;
+        if (!memcmp(name, "setIcon", 7)) return PROTO_CMD_SET_ICON;
+        break;
+    case 8:
+        if (!memcmp(name, "keepMenu", 8)) return PROTO_CMD_KEEP_MENU;
+        if (!memcmp(name, "setLabel", 8)) return PROTO_CMD_SET_LABEL;
+        if (!memcmp(name, "setBadge", 8)) return PROTO_CMD_SET_BADGE;
+        if (!memcmp(name, "getStats", 8)) return PROTO_CMD_GET_STATS;
+        break;
+    case 9:
+        if (!memcmp(name, "setStatus", 9)) return PROTO_CMD_SET_STATUS;
+        break;
+    case 10:
+        if (!memcmp(name, "setTooltip", 10)) return PROTO_CMD_SET_TOOLTIP;
+        if (!memcmp(name, "stopTicker", 10)) return PROTO_CMD_STOP_TICKER;
+        if (!memcmp(name, "pushSample", 10)) return PROTO_CMD_PUSH_SAMPLE;
+        if (!memcmp(name, "createTray", 10)) return PROTO_CMD_CREATE_TRAY;
+        break;
+    case 11:
+        if (!memcmp(name, "startTicker", 11)) return PROTO_CMD_START_TICKER;
+        if (!memcmp(name, "setIconFile", 11)) return PROTO_CMD_SET_ICON_FILE;
+        if (!memcmp(name, "setProgress", 11)) return PROTO_CMD_SET_PROGRESS;
+        if (!memcmp(name, "destroyTray", 11)) return PROTO_CMD_DESTROY_TRAY;
+        break;
+    case 12:
+        if (!memcmp(name, "setSparkline", 12)) return PROTO_CMD_SET_SPARKLINE;
+        break;
+    case 16:
+        if (!memcmp(name, "setAttentionIcon", 16)) return PROTO_CMD_SET_ATTENTION_ICON;
+        break;
+    }
+    return PROTO_CMD_UNKNOWN;
+}
+
+ProtoSlot proto_command_slot(ProtoCommand cmd) {
+    switch (cmd) {
+    case PROTO_CMD_SET_MENU: return PROTO_SLOT_MENU;
+    case PROTO_CMD_SET_ICON: return PROTO_SLOT_ICON;
+    case PROTO_CMD_SET_ATTENTION_ICON: return PROTO_SLOT_ATTENTION_ICON;
+    case PROTO_CMD_SET_STATUS: return PROTO_SLOT_STATUS;
+    case PROTO_CMD_SET_TOOLTIP: return PROTO_SLOT_TITLE;
+    case PROTO_CMD_SET_LABEL: return PROTO_SLOT_LABEL;
+    case PROTO_CMD_START_TICKER: return PROTO_SLOT_TICKER;
+    case PROTO_CMD_STOP_TICKER: return PROTO_SLOT_TICKER;
+    case PROTO_CMD_SET_ICON_FILE: return PROTO_SLOT_ICON;
+    case PROTO_CMD_SET_SPARKLINE: return PROTO_SLOT_ICON;
+    case PROTO_CMD_SET_BADGE: return PROTO_SLOT_BADGE;
+    case PROTO_CMD_SET_PROGRESS: return PROTO_SLOT_PROGRESS;
+    default: return PROTO_SLOT_NONE;
+    }
+}
+
+const char *proto_slot_name(ProtoSlot slot) {
+    static const char *const names[] = {
+        [PROTO_SLOT_MENU] = "menu",
+        [PROTO_SLOT_ICON] = "icon",
+        [PROTO_SLOT_ATTENTION_ICON] = "attentionIcon",
+        [PROTO_SLOT_STATUS] = "status",
+        [PROTO_SLOT_TITLE] = "title",
+        [PROTO_SLOT_LABEL] = "label",
+        [PROTO_SLOT_TICKER] = "ticker",
+        [PROTO_SLOT_BADGE] = "badge",
+        [PROTO_SLOT_PROGRESS] = "progress",
+    };
+    return slot > PROTO_SLOT_NONE && slot < PROTO_SLOT_COUNT ? names[slot] : NULL;
+}
+
+uint32_t proto_line_digest(const char *line, size_t len) {
+    size_t i = len ? 1 : 0;
+    if (len - i > 7 && !memcmp(line + i, "\"tray\":", 7)) {
+        const char *comma = memchr(line + i, ',', len - i);
+        if (comma) i = comma - line + 1;
+    }
+    uint32_t h = 2166136261u;
+    if (len) h = (h ^ (unsigned char)line[0]) * 16777619u;
+    for (; i < len; i++) h = (h ^ (unsigned char)line[i]) * 16777619u;
+    return h;
+}
+
+void proto_envelope(const cJSON *msg, ProtoEnvelope *out) {
+    for (const cJSON *c = msg->child; c && c->string; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 4:
+            if (!memcmp(c->string, "tray", 4) && cJSON_IsNumber(c)) { out->tray = c->valueint; out->hasTray = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeSetMenu(const cJSON *params, ProtoSetMenu *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 5:
+            if (!memcmp(c->string, "items", 5)) out->items = (cJSON *)c;
+            break;
+        case 9:
+            if (!memcmp(c->string, "requestId", 9) && cJSON_IsNumber(c)) { out->requestId = c->valueint; out->hasRequestId = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeKeepMenu(const cJSON *params, ProtoKeepMenu *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 9:
+            if (!memcmp(c->string, "requestId", 9) && cJSON_IsNumber(c)) { out->requestId = c->valueint; out->hasRequestId = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeSetIcon(const cJSON *params, ProtoSetIcon *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 3:
+            if (!memcmp(c->string, "svg", 3) && cJSON_IsString(c)) out->svg = c->valuestring;
+            break;
+        case 4:
+            if (!memcmp(c->string, "size", 4) && cJSON_IsNumber(c)) { out->size = c->valueint; out->hasSize = 1; }
+            break;
+        case 6:
+            if (!memcmp(c->string, "base64", 6) && cJSON_IsString(c)) out->base64 = c->valuestring;
+            if (!memcmp(c->string, "vector", 6) && cJSON_IsString(c)) out->vector = c->valuestring;
+            break;
+        }
+    }
+}
+
+static void decodeSetAttentionIcon(const cJSON *params, ProtoSetAttentionIcon *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 3:
+            if (!memcmp(c->string, "svg", 3) && cJSON_IsString(c)) out->svg = c->valuestring;
+            break;
+        case 4:
+            if (!memcmp(c->string, "size", 4) && cJSON_IsNumber(c)) { out->size = c->valueint; out->hasSize = 1; }
+            break;
+        case 6:
+            if (!memcmp(c->string, "base64", 6) && cJSON_IsString(c)) out->base64 = c->valuestring;
+            if (!memcmp(c->string, "vector", 6) && cJSON_IsString(c)) out->vector = c->valuestring;
+            break;
+        }
+    }
+}
+
+static void decodeSetStatus(const cJSON *params, ProtoSetStatus *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 6:
+            if (!memcmp(c->string, "status", 6) && cJSON_IsString(c)) out->status = c->valuestring;
+            break;
+        }
+    }
+}
+
+static void decodeSetTooltip(const cJSON *params, ProtoSetTooltip *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 4:
+            if (!memcmp(c->string, "text", 4) && cJSON_IsString(c)) out->text = c->valuestring;
+            break;
+        }
+    }
+}
+
+static void decodeSetLabel(const cJSON *params, ProtoSetLabel *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 4:
+            if (!memcmp(c->string, "text", 4) && cJSON_IsString(c)) out->text = c->valuestring;
+            break;
+        case 5:
+            if (!memcmp(c->string, "guide", 5) && cJSON_IsString(c)) out->guide = c->valuestring;
+            break;
+        case 7:
+            if (!memcmp(c->string, "maxRate", 7) && cJSON_IsNumber(c)) { out->maxRate = c->valueint; out->hasMaxRate = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeStartTicker(const cJSON *params, ProtoStartTicker *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 2:
+            if (!memcmp(c->string, "to", 2) && cJSON_IsNumber(c)) { out->to = c->valuedouble; out->hasTo = 1; }
+            break;
+        case 4:
+            if (!memcmp(c->string, "from", 4) && cJSON_IsNumber(c)) { out->from = c->valuedouble; out->hasFrom = 1; }
+            break;
+        case 6:
+            if (!memcmp(c->string, "format", 6) && cJSON_IsString(c)) out->format = c->valuestring;
+            if (!memcmp(c->string, "target", 6) && cJSON_IsString(c)) out->target = c->valuestring;
+            break;
+        case 8:
+            if (!memcmp(c->string, "interval", 8) && cJSON_IsNumber(c)) { out->interval = c->valueint; out->hasInterval = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeSetIconFile(const cJSON *params, ProtoSetIconFile *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 4:
+            if (!memcmp(c->string, "path", 4) && cJSON_IsString(c)) out->path = c->valuestring;
+            break;
+        case 5:
+            if (!memcmp(c->string, "watch", 5)) out->watch = cJSON_IsTrue(c);
+            break;
+        }
+    }
+}
+
+static void decodeSetSparkline(const cJSON *params, ProtoSetSparkline *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 3:
+            if (!memcmp(c->string, "fps", 3) && cJSON_IsNumber(c)) { out->fps = c->valueint; out->hasFps = 1; }
+            if (!memcmp(c->string, "min", 3) && cJSON_IsNumber(c)) { out->min = c->valuedouble; out->hasMin = 1; }
+            if (!memcmp(c->string, "max", 3) && cJSON_IsNumber(c)) { out->max = c->valuedouble; out->hasMax = 1; }
+            break;
+        case 5:
+            if (!memcmp(c->string, "color", 5) && cJSON_IsString(c)) out->color = c->valuestring;
+            break;
+        case 7:
+            if (!memcmp(c->string, "samples", 7) && cJSON_IsNumber(c)) { out->samples = c->valueint; out->hasSamples = 1; }
+            break;
+        }
+    }
+}
+
+static void decodePushSample(const cJSON *params, ProtoPushSample *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 1:
+            if (!memcmp(c->string, "v", 1) && cJSON_IsNumber(c)) { out->v = c->valuedouble; out->hasV = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeSetBadge(const cJSON *params, ProtoSetBadge *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 4:
+            if (!memcmp(c->string, "text", 4) && cJSON_IsString(c)) out->text = c->valuestring;
+            break;
+        }
+    }
+}
+
+static void decodeSetProgress(const cJSON *params, ProtoSetProgress *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 5:
+            if (!memcmp(c->string, "value", 5) && cJSON_IsNumber(c)) { out->value = c->valuedouble; out->hasValue = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeCreateTray(const cJSON *params, ProtoCreateTray *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 2:
+            if (!memcmp(c->string, "id", 2) && cJSON_IsNumber(c)) { out->id = c->valueint; out->hasId = 1; }
+            break;
+        case 7:
+            if (!memcmp(c->string, "tooltip", 7) && cJSON_IsString(c)) out->tooltip = c->valuestring;
+            break;
+        case 10:
+            if (!memcmp(c->string, "menuWindow", 10) && cJSON_IsNumber(c)) { out->menuWindow = c->valueint; out->hasMenuWindow = 1; }
+            break;
+        case 12:
+            if (!memcmp(c->string, "menuDeadline", 12) && cJSON_IsNumber(c)) { out->menuDeadline = c->valueint; out->hasMenuDeadline = 1; }
+            if (!memcmp(c->string, "scrollWindow", 12) && cJSON_IsNumber(c)) { out->scrollWindow = c->valueint; out->hasScrollWindow = 1; }
+            break;
+        }
+    }
+}
+
+static void decodeDestroyTray(const cJSON *params, ProtoDestroyTray *out) {
+    for (const cJSON *c = params->child; c; c = c->next) {
+        size_t len = strlen(c->string);
+        switch (len) {
+        case 2:
+            if (!memcmp(c->string, "id", 2) && cJSON_IsNumber(c)) { out->id = c->valueint; out->hasId = 1; }
+            break;
+        }
+    }
+}
+
+ProtoCommand proto_dispatch(const cJSON *msg, const ProtoHandlers *handlers, void *ctx) {
+    const cJSON *method = NULL, *params = NULL;
+    for (const cJSON *c = msg->child; c && c->string; c = c->next) {
+        if (!strcmp(c->string, "method")) method = c;
+        else if (!strcmp(c->string, "params")) params = c;
+    }
+    if (!cJSON_IsString(method)) return PROTO_CMD_UNKNOWN;
+    static const cJSON noParams;
+    if (!cJSON_IsObject(params)) params = &noParams;
+
+    ProtoCommand cmd = proto_command(method->valuestring, strlen(method->valuestring));
+    switch (cmd) {
+    case PROTO_CMD_SET_MENU:
+        if (!handlers->setMenu) break;
+        {
+            ProtoSetMenu p = {0};
+            decodeSetMenu(params, &p);
+            handlers->setMenu(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_KEEP_MENU:
+        if (!handlers->keepMenu) break;
+        {
+            ProtoKeepMenu p = {0};
+            decodeKeepMenu(params, &p);
+            handlers->keepMenu(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_ICON:
+        if (!handlers->setIcon) break;
+        {
+            ProtoSetIcon p = {0};
+            decodeSetIcon(params, &p);
+            handlers->setIcon(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_ATTENTION_ICON:
+        if (!handlers->setAttentionIcon) break;
+        {
+            ProtoSetAttentionIcon p = {0};
+            decodeSetAttentionIcon(params, &p);
+            handlers->setAttentionIcon(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_STATUS:
+        if (!handlers->setStatus) break;
+        {
+            ProtoSetStatus p = {0};
+            decodeSetStatus(params, &p);
+            handlers->setStatus(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_TOOLTIP:
+        if (!handlers->setTooltip) break;
+        {
+            ProtoSetTooltip p = {0};
+            decodeSetTooltip(params, &p);
+            handlers->setTooltip(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_LABEL:
+        if (!handlers->setLabel) break;
+        {
+            ProtoSetLabel p = {0};
+            decodeSetLabel(params, &p);
+            handlers->setLabel(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_START_TICKER:
+        if (!handlers->startTicker) break;
+        {
+            ProtoStartTicker p = {0};
+            decodeStartTicker(params, &p);
+            handlers->startTicker(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_STOP_TICKER:
+        if (!handlers->stopTicker) break;
+        handlers->stopTicker(ctx);
+        return cmd;
+    case PROTO_CMD_SET_ICON_FILE:
+        if (!handlers->setIconFile) break;
+        {
+            ProtoSetIconFile p = {0};
+            decodeSetIconFile(params, &p);
+            handlers->setIconFile(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_SPARKLINE:
+        if (!handlers->setSparkline) break;
+        {
+            ProtoSetSparkline p = {0};
+            decodeSetSparkline(params, &p);
+            handlers->setSparkline(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_PUSH_SAMPLE:
+        if (!handlers->pushSample) break;
+        {
+            ProtoPushSample p = {0};
+            decodePushSample(params, &p);
+            handlers->pushSample(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_BADGE:
+        if (!handlers->setBadge) break;
+        {
+            ProtoSetBadge p = {0};
+            decodeSetBadge(params, &p);
+            handlers->setBadge(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_SET_PROGRESS:
+        if (!handlers->setProgress) break;
+        {
+            ProtoSetProgress p = {0};
+            decodeSetProgress(params, &p);
+            handlers->setProgress(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_GET_STATS:
+        if (!handlers->getStats) break;
+        handlers->getStats(ctx);
+        return cmd;
+    case PROTO_CMD_CREATE_TRAY:
+        if (!handlers->createTray) break;
+        {
+            ProtoCreateTray p = {0};
+            decodeCreateTray(params, &p);
+            handlers->createTray(ctx, &p);
+        }
+        return cmd;
+    case PROTO_CMD_DESTROY_TRAY:
+        if (!handlers->destroyTray) break;
+        {
+            ProtoDestroyTray p = {0};
+            decodeDestroyTray(params, &p);
+            handlers->destroyTray(ctx, &p);
+        }
+        return cmd;
+    default:
+        break;
+    }
+    return PROTO_CMD_UNKNOWN;
+}
@@ -1,10 +1,16 @@
-import { spawn, ChildProcess } from 'node:child_process';
-import { createInterface, Interface } from 'node:readline';
+import { spawn } from 'node:child_process';
+import { createInterface } from 'node:readline';
 import { createRequire } from 'node:module';
-import { dirname, join } from 'node:path';
+import { createConnection } from 'node:net';
+import { tmpdir } from 'node:os';
+import { dirname, join, resolve } from 'node:path';
 import { fileURLToPath } from 'node:url';
 import { readFileSync } from 'node:fs';
 import { EventEmitter } from 'node:events';
+import { MessageChannel, type MessagePort } from 'node:worker_threads';
+import {
+  PROTOCOL_VERSION, STATE_SLOTS, encode, decodeEvent, lineDigest, withEnvelope, type Commands, type Event,
+} from './protocol.js';
 
 const require = createRequire(import.meta.url);
 const __dirname = dirname(fileURLToPath(import.meta.url));
@@ -20,6 +26,13 @@ const PLATFORMS: Record<string, string> = {
 
 const BIN_NAME = process.platform === 'win32' ? 'tray.exe' : 'tray';
 
+/**
+ * Linux tray backend: `'appindicator'` (GTK + libayatana-appindicator, the
+ * default), `'sni'` (StatusNotifierItem over plain D-Bus, no GTK) or
+ * `'headless'` (state kept in memory, for benchmarks and CI).
+ */
+export type Backend = 'appindicator' | 'sni' | 'headless';
+
 export interface MenuItem {
   id: string;
   title?: string;
@@ -33,103 +46,935 @@ export interface MenuItem {
 export interface Icon {
   png: string;
   ico: string;
+  /** SVG source path; preferred on Linux, where it is rasterized at the panel's pixel size. */
+  svg?: string;
+}
+
+/**
+ * Vector icon drawing command. Coordinates are in a 100×100 box that the
+ * native side scales to the panel's pixel size.
+ */
+export type DrawCommand =
+  | { op: 'fill'; color: string | null }
+  | { op: 'stroke'; color: string | null; width?: number }
+  | { op: 'circle'; cx: number; cy: number; r: number }
+  | { op: 'rect'; x: number; y: number; w: number; h: number; radius?: number }
+  | { op: 'arc'; cx: number; cy: number; r: number; from: number; to: number }
+  | { op: 'text'; x: number; y: number; size: number; text: string; bold?: boolean };
+
+export interface SparklineOptions {
+  /** Number of samples shown (default 32). */
+  samples?: number;
+  /** Maximum redraws per second (default 4). */
+  fps?: number;
+  /** Fixed value range; auto-scaled to the visible samples when omitted. */
+  min?: number;
+  max?: number;
+  /** Line color, `#rrggbb` (default white). */
+  color?: string;
+}
+
+export interface TickerOptions {
+  /**
+   * `%H` (total hours), `%M`, `%S` for elapsed/countdown tickers; strftime
+   * for a clock. Defaults to `'%H:%M:%S'`, or `'%H:%M'` for a clock.
+   */
+  format?: string;
+  /** Count up from this time (ms since the epoch or a Date). */
+  from?: number | Date;
+  /** Count down to this time; takes precedence over `from`. */
+  to?: number | Date;
+  /** Update period in ms (default 1000, or 60000 without seconds in the format). */
+  interval?: number;
+  /** Where the text is shown (default `'label'`). */
+  target?: 'label' | 'tooltip';
 }
 
+/** Mouse wheel movement over the icon, summed over the aggregation window. */
+export interface ScrollEvent {
+  /** Horizontal steps, positive to the right. */
+  dx: number;
+  /** Vertical steps, positive downwards. */
+  dy: number;
+  /** Raw wheel events folded into this one. */
+  count: number;
+  /** Raw wheel events since the tray started. */
+  total: number;
+}
+
+export type TrayStatus = 'active' | 'passive' | 'attention';
+
+/**
+ * A menu, optionally tagged with a version `key`. When the key equals the
+ * key of the menu currently shown, the result is not serialized or sent.
+ */
+export type MenuResult = MenuItem[] | { items: MenuItem[]; key: unknown };
+
+export type MenuProvider = (signal: AbortSignal) => MenuResult | Promise<MenuResult>;
+
 export interface TrayOptions {
+  backend?: Backend;
   icon?: Icon;
+  attentionIcon?: Icon;
   tooltip?: string;
-  onMenuRequested?: () => MenuItem[] | Promise<MenuItem[]>;
+  /**
+   * Linux: hold the shell's menu-open call for up to this many ms until
+   * `onMenuRequested` has produced a menu, so the first paint is fresh.
+   */
+  menuDeadline?: number;
+  /**
+   * Linux: menu opens within this many ms of the previous request, or while
+   * `onMenuRequested` is still running, reuse that request (default 100).
+   */
+  menuWindow?: number;
+  /** Linux: wheel events are summed and delivered at most once per this many ms (default 50). */
+  scrollWindow?: number;
+  /**
+   * Serialize menus incrementally, yielding to the event loop after every
+   * slice of this many ms, for menus with thousands of items. Commands sent
+   * meanwhile are queued behind the menu.
+   */
+  menuSliceMs?: number;
+  /**
+   * Linux: run the tray inside this process through the N-API addon
+   * (`trayjs.node`, GTK-free like `backend: 'sni'`) instead of a helper
+   * process. Falls back to the helper when the addon cannot be loaded or for
+   * `backend: 'appindicator'`. Further in-process trays share the addon.
+   */
+  inProcess?: boolean;
+  /**
+   * Linux: show this tray from the helper process of an earlier shared tray
+   * with the same backend instead of spawning another one. Each extra icon
+   * then costs a D-Bus item rather than a process.
+   */
+  shared?: boolean;
+  /**
+   * Linux: show the tray from a helper daemon of this name (unique per app)
+   * that outlives the process. The first tray starts it; when the process
+   * exits or calls `detach()`, the daemon keeps the tray shown as it was, and
+   * the next process's trays resume it without a restart. `quit()` removes
+   * the tray, and the daemon exits with its last one. Takes precedence over
+   * `inProcess` and `shared`.
+   */
+  daemon?: string;
+  /**
+   * Builds the menu when it is opened. Runs are single-flight: if the menu is
+   * requested again meanwhile, `signal` is aborted and one rerun follows, and
+   * only the newest result is applied.
+   */
+  onMenuRequested?: MenuProvider;
+  /**
+   * Cheap dependency key for the menu. When it matches the key of the menu
+   * currently shown, `onMenuRequested` is skipped and the menu is reused.
+   */
+  menuKey?: () => unknown;
   onClicked?: (id: string) => void;
+  /** Called when the mouse wheel moves over the icon (Linux). */
+  onScrolled?: (event: ScrollEvent) => void;
 }
 
-function resolveIcon(icon: Icon): Buffer {
+// |svg|: the helper renders SVG, which goes instead of the PNG on Linux
+function iconParams(icon: Icon, svg: boolean): Commands['setIcon'] {
+  if (process.platform === 'linux' && icon.svg && svg)
+    return { svg: readFileSync(icon.svg, 'utf8') };
   const path = process.platform === 'win32' ? icon.ico : icon.png;
-  return readFileSync(path);
+  return { base64: readFileSync(path).toString('base64') };
+}
+
+function encodeDrawCommands(commands: DrawCommand[]): string {
+  return commands.map(c => {
+    switch (c.op) {
+      case 'fill': return `F${c.color ?? '-'}`;
+      case 'stroke': return `S${c.color ?? '-'}` + (c.color && c.width !== undefined ? `,${c.width}` : '');
+      case 'circle': return `c${c.cx},${c.cy},${c.r}`;
+      case 'rect': return `r${c.x},${c.y},${c.w},${c.h}` + (c.radius ? `,${c.radius}` : '');
+      case 'arc': return `a${c.cx},${c.cy},${c.r},${c.from},${c.to}`;
+      case 'text': return `${c.bold ? 'T' : 't'}${c.x},${c.y},${c.size},${c.text.replace(/;/g, '')}`;
+    }
+  }).join(';');
+}
+
+// Serialized form of deeply frozen menu subtrees, by identity. `null`
+// marks a subtree that is frozen itself but has a mutable descendant.
+const menuJsonCache = new WeakMap<object, string | null>();
+
+/** Deep-freezes a menu so `Tray` can reuse its serialized form across updates. */
+export function freezeMenu<T extends MenuItem | readonly MenuItem[]>(menu: T): T {
+  const items = (Array.isArray(menu) ? menu : [menu]) as readonly MenuItem[];
+  for (const item of items) {
+    if (item.items) freezeMenu(item.items);
+    Object.freeze(item);
+  }
+  return Object.freeze(menu) as T;
+}
+
+// Returns the JSON text and whether the whole subtree is frozen.
+function menuToJson(node: MenuItem | readonly MenuItem[]): [string, boolean] {
+  const frozen = Object.isFrozen(node);
+  const cached = frozen ? menuJsonCache.get(node) : undefined;
+  if (cached) return [cached, true];
+
+  let json: string;
+  let immutable = frozen;
+  if (Array.isArray(node)) {
+    const parts: string[] = [];
+    for (const item of node as readonly MenuItem[]) {
+      const [text, childImmutable] = menuToJson(item);
+      parts.push(text);
+      immutable &&= childImmutable;
+    }
+    json = `[${parts.join(',')}]`;
+  } else {
+    const { items, ...rest } = node as MenuItem;
+    json = JSON.stringify(rest);
+    if (items) {
+      const [text, childImmutable] = menuToJson(items);
+      json = `${json.slice(0, -1)}${json.length > 2 ? ',' : ''}"items":${text}}`;
+      immutable &&= childImmutable;
+    }
+  }
+  if (frozen) menuJsonCache.set(node, immutable ? json : null);
+  return [json, immutable];
+}
+
+// Same output as menuToJson, appended to `out` piece by piece; yields after
+// every item. Cached frozen subtrees are reused but not added to the cache.
+function* menuJsonParts(items: readonly MenuItem[], out: string[]): Generator<void, void, undefined> {
+  const cached = Object.isFrozen(items) ? menuJsonCache.get(items) : undefined;
+  if (cached) {
+    out.push(cached);
+    return;
+  }
+  out.push('[');
+  for (let i = 0; i < items.length; i++) {
+    if (i) out.push(',');
+    const item = items[i];
+    const itemCached = Object.isFrozen(item) ? menuJsonCache.get(item) : undefined;
+    if (itemCached) {
+      out.push(itemCached);
+    } else {
+      const { items: children, ...rest } = item;
+      const json = JSON.stringify(rest);
+      if (children) {
+        out.push(`${json.slice(0, -1)}${json.length > 2 ? ',' : ''}"items":`);
+        yield* menuJsonParts(children, out);
+        out.push('}');
+      } else {
+        out.push(json);
+      }
+    }
+    yield;
+  }
+  out.push(']');
+}
+
+// Serializes a menu in slices of about `sliceMs`, one chunk per slice, so
+// the event loop runs between them. Stops early once `job` is canceled.
+async function menuJsonChunks(items: readonly MenuItem[], sliceMs: number, job: { canceled: boolean }): Promise<string[]> {
+  const chunks: string[] = [];
+  const parts: string[] = [];
+  let deadline = performance.now() + sliceMs;
+  for (const _ of menuJsonParts(items, parts)) {
+    if (performance.now() < deadline) continue;
+    chunks.push(parts.join(''));
+    parts.length = 0;
+    await new Promise(resolve => setImmediate(resolve));
+    if (job.canceled) return chunks;
+    deadline = performance.now() + sliceMs;
+  }
+  chunks.push(parts.join(''));
+  return chunks;
 }
 
-function getBinaryPath(): string {
+function getBinaryPath(backend?: Backend): string {
   const key = `${process.platform}-${process.arch}`;
+  const gtkFree = backend === 'sni' || backend === 'headless';
+  const bin = process.platform === 'linux' && gtkFree ? 'tray-sni' : BIN_NAME;
   if (process.env.DEV)
-    return join(__dirname, '..', 'binaries', key, 'bin', BIN_NAME);
+    return join(__dirname, '..', 'binaries', key, 'bin', bin);
 
   const pkg = PLATFORMS[key];
   if (!pkg)
     throw new Error(`@trayjs/trayjs: unsupported platform ${key}`);
   const pkgJson = require.resolve(`${pkg}/package.json`);
-  return join(dirname(pkgJson), 'bin', BIN_NAME);
+  return join(dirname(pkgJson), 'bin', bin);
+}
+
+// What a TrayHandle posts to its Tray: one batch of encoded lines
+interface HandleBatch {
+  lines: string[];
+  menu: boolean;
+}
+
+// The in-process core (src-linux/addon.c)
+interface Addon {
+  start(args: string[], onLine: (line: string | null, code?: number) => void): void;
+  command(lines: readonly string[]): void;
+  setIcon(png: Buffer, attention: boolean, tray?: number): void;
+  stop(): void;
+}
+
+function loadAddon(): Addon | undefined {
+  try {
+    return require(join(dirname(getBinaryPath('sni')), 'trayjs.node')) as Addon;
+  } catch {
+    return undefined;
+  }
+}
+
+// What a Host routes to one of its trays
+interface HostClient {
+  event(msg: Event): void;
+  closed(code: number | null): void;
+}
+
+/**
+ * The native side of one or more trays: a helper process, or the addon.
+ * The first tray is tray 0 and is created from the command line; later
+ * ones are added with createTray and addressed through the envelope.
+ */
+class Host {
+  static #shared = new Map<string, Host>();
+
+  readonly addon?: Addon;
+  #write: (chunks: readonly string[]) => void;
+  #end: () => void;
+  #key?: string;
+  #clients = new Map<number, HostClient>();
+  #nextId = 1;
+  // A daemon outlives its clients: trays are left to it rather than ended,
+  // and each one's lines wait for its ready. A resumed ready reports the
+  // digest of each slot's line; lines repeating one are dropped until the
+  // first that changes something, as later lines may depend on it.
+  #persistent = false;
+  #held = new Map<number, string[][]>();
+  #resume = new Map<number, Record<string, string>>();
+
+  private constructor(write: (chunks: readonly string[]) => void, end: () => void, addon?: Addon) {
+    this.#write = write;
+    this.#end = end;
+    this.addon = addon;
+  }
+
+  /**
+   * Adds a tray to the host shared under `key`, or to a new host from
+   * `start` (shared under `key` when given). Returns the host and the
+   * tray's id, or undefined when `start` cannot provide a host.
+   */
+  static attach(key: string | undefined, client: HostClient, params: Omit<Commands['createTray'], 'id'>,
+                start: () => Host | undefined): [Host, number] | undefined {
+    const existing = key === undefined ? undefined : Host.#shared.get(key);
+    if (existing) {
+      const id = existing.#nextId++;
+      existing.#clients.set(id, client);
+      if (existing.#persistent) existing.#held.set(id, []);
+      existing.#write([encode.createTray({ id, ...params })]);
+      return [existing, id];
+    }
+    const host = start();
+    if (!host) return undefined;
+    host.#clients.set(0, client);
+    if (host.#persistent) {
+      // A daemon may have tray 0 from an earlier client; this applies our
+      // options to it, or recreates it with them
+      host.#held.set(0, []);
+      host.#write([encode.createTray({ id: 0, ...params })]);
+    }
+    if (key !== undefined) {
+      host.#key = key;
+      Host.#shared.set(key, host);
+    }
+    return [host, 0];
+  }
+
+  static spawn(backend: Backend | undefined, args: string[]): Host {
+    const proc = spawn(getBinaryPath(backend), args, {
+      stdio: ['pipe', 'pipe', 'inherit'],
+    });
+    const stdin = proc.stdin!;
+    const host = new Host(chunks => {
+      if (chunks.length === 1) {
+        stdin.write(chunks[0]);
+        return;
+      }
+      stdin.cork();
+      for (const chunk of chunks) stdin.write(chunk);
+      stdin.uncork();
+    }, () => stdin.end());
+    createInterface({ input: proc.stdout! }).on('line', line => host.#line(line));
+    proc.on('close', (code: number | null) => host.#exit(code));
+    return host;
+  }
+
+  static startAddon(args: string[]): Host | undefined {
+    const addon = loadAddon();
+    if (!addon) return undefined;
+    const host = new Host(chunks => addon.command(chunks), () => addon.stop(), addon);
+    try {
+      addon.start(args, (line, code) => line === null ? host.#exit(code ?? null) : host.#line(line));
+    } catch {
+      // The core is one-shot: once its last tray has quit, later in-process
+      // trays use a helper process
+      process.emitWarning('@trayjs/trayjs: the in-process tray core has already run in this process; using a helper');
+      return undefined;
+    }
+    return host;
+  }
+
+  /**
+   * Connects to the daemon listening on `path`, starting it when there is
+   * none. Lines written meanwhile are buffered.
+   */
+  static connect(path: string, backend: Backend | undefined, args: string[]): Host {
+    let pending: string[] | null = [];
+    let socket: ReturnType<typeof createConnection> | undefined;
+    let ending = false;
+    const host = new Host(chunks => {
+      if (pending) pending.push(...chunks);
+      else socket!.write(chunks.join(''));
+    }, () => {
+      ending = true;
+      socket?.end();
+    });
+    host.#persistent = true;
+
+    let started = false;
+    const deadline = Date.now() + 5000;
+    const attempt = (): void => {
+      const s = createConnection(path);
+      s.once('connect', () => {
+        socket = s;
+        createInterface({ input: s }).on('line', line => host.#line(line));
+        s.on('close', () => host.#exit(null));
+        s.on('error', () => {});
+        s.write(pending!.join(''));
+        pending = null;
+        if (ending) s.end();
+      });
+      s.once('error', (err: NodeJS.ErrnoException) => {
+        if (socket === s) return;
+        if ((err.code !== 'ENOENT' && err.code !== 'ECONNREFUSED') || ending || Date.now() > deadline) {
+          host.#exit(null);
+          return;
+        }
+        if (!started) {
+          started = true;
+          spawn(getBinaryPath(backend), [...args, '--daemon', path], {
+            detached: true,
+            stdio: ['ignore', 'ignore', 'inherit'],
+          }).unref();
+        }
+        setTimeout(attempt, 10);
+      });
+    };
+    attempt();
+    return host;
+  }
+
+  write(chunks: readonly string[], id = 0): void {
+    if (this.#persistent) {
+      const held = this.#held.get(id);
+      if (held) {
+        held.push([...chunks]);
+        return;
+      }
+      const resume = this.#resume.get(id);
+      if (resume) {
+        const line = chunks.join('');
+        const slot = STATE_SLOTS[line.slice(11, line.indexOf('"', 11)) as keyof Commands];
+        if (slot && resume[slot] === lineDigest(line)) return;
+        if (slot) this.#resume.delete(id);
+      }
+    }
+    if (id === 0) {
+      this.#write(chunks);
+      return;
+    }
+    const [first, ...rest] = chunks;
+    this.#write([withEnvelope(first, { tray: id }), ...rest]);
+  }
+
+  /** Removes tray `id`; the host ends with its last tray. */
+  detach(id: number): void {
+    if (!this.#clients.has(id)) return;
+    if (this.#persistent) this.#write([encode.destroyTray({ id })]);
+    else if (this.#clients.size === 1) this.#stop();
+    else this.write([encode.destroyTray({ id })]);
+  }
+
+  /** Leaves tray `id` to a daemon as it is; like detach() for other hosts. */
+  release(id: number): void {
+    const client = this.#clients.get(id);
+    if (!client) return;
+    if (!this.#persistent) {
+      this.detach(id);
+      return;
+    }
+    this.#forget(id);
+    client.closed(0);
+    if (!this.#clients.size) this.#stop();
+  }
+
+  #forget(id: number): void {
+    this.#clients.delete(id);
+    this.#held.delete(id);
+    this.#resume.delete(id);
+  }
+
+  // New trays get a fresh host from here on
+  #unshare(): void {
+    if (this.#key !== undefined && Host.#shared.get(this.#key) === this) Host.#shared.delete(this.#key);
+  }
+
+  #stop(): void {
+    this.#unshare();
+    this.#end();
+  }
+
+  #line(line: string): void {
+    const msg = decodeEvent(line);
+    if (!msg) return;
+    const id = msg.tray ?? 0;
+    const client = this.#clients.get(id);
+    if (msg.method === 'ready' && this.#held.has(id)) {
+      const held = this.#held.get(id)!;
+      this.#held.delete(id);
+      if (msg.params.resumed && msg.params.state) this.#resume.set(id, { ...msg.params.state });
+      for (const chunks of held) this.write(chunks, id);
+    }
+    if (msg.method !== 'closed') {
+      client?.event(msg);
+      return;
+    }
+    this.#forget(id);
+    client?.closed(0);
+    if (!this.#clients.size) this.#stop();
+  }
+
+  #exit(code: number | null): void {
+    this.#unshare();
+    const clients = [...this.#clients.values()];
+    this.#clients.clear();
+    this.#held.clear();
+    this.#resume.clear();
+    for (const client of clients) client.closed(code);
+  }
 }
 
 export class Tray extends EventEmitter {
-  #proc: ChildProcess;
-  #rl: Interface;
-  #menuRequestedCb?: () => MenuItem[] | Promise<MenuItem[]>;
+  // Native side: a helper process or the in-process addon, maybe shared
+  #host: Host;
+  #id: number;
+  #menuRequestedCb?: MenuProvider;
+  #menuKeyCb?: () => unknown;
+  #appliedMenuKey: unknown = undefined;
+  #menuRun: Promise<void> | null = null;
+  #menuAbort: AbortController | null = null;
+  #menuRequestId?: number;
+  #menuRerun: { requestId?: number } | null = null;
   #clickedCb?: (id: string) => void;
+  #scrolledCb?: (event: ScrollEvent) => void;
   #pendingIcon?: Icon | null;
+  // Last icons sent, resent as PNG when their SVG does not render
+  #shownIcons: [Icon?, Icon?] = [];
+  #svg = true;
+  #pendingAttentionIcon?: Icon | null;
+  #menuSliceMs?: number;
+  #menuEncode: { canceled: boolean } | null = null;
+  #queued: (() => void)[] = [];
+  #ports = new Set<MessagePort>();
+  #isClosed = false;
 
-  constructor({ icon, tooltip, onMenuRequested, onClicked }: TrayOptions = {}) {
+  constructor({
+    backend, icon, attentionIcon, tooltip, menuDeadline, menuWindow, scrollWindow, menuSliceMs, inProcess, shared,
+    daemon, onMenuRequested, menuKey, onClicked, onScrolled,
+  }: TrayOptions = {}) {
     super();
     this.#menuRequestedCb = onMenuRequested;
+    this.#menuKeyCb = menuKey;
     this.#clickedCb = onClicked;
+    this.#scrolledCb = onScrolled;
     this.#pendingIcon = icon;
+    this.#pendingAttentionIcon = attentionIcon;
+    this.#menuSliceMs = menuSliceMs;
 
-    const bin = getBinaryPath();
     const args: string[] = [];
     if (tooltip) args.push('--tooltip', tooltip);
+    if (process.platform === 'linux' && backend === 'headless') args.push('--backend', 'headless');
+    if (process.platform === 'linux' && menuDeadline) args.push('--menu-deadline', String(menuDeadline));
+    if (process.platform === 'linux' && menuWindow !== undefined) args.push('--menu-window', String(menuWindow));
+    if (process.platform === 'linux' && scrollWindow !== undefined) args.push('--scroll-window', String(scrollWindow));
 
-    this.#proc = spawn(bin, args, {
-      stdio: ['pipe', 'pipe', 'inherit'],
-    });
+    const linux = process.platform === 'linux';
+    const client: HostClient = { event: msg => this.#handle(msg), closed: code => this.#closed(code) };
+    // A daemon's tray gets its tooltip as a line, which a resume can skip
+    const params = { tooltip: daemon && linux ? undefined : tooltip, menuDeadline, menuWindow, scrollWindow };
+    const socket = daemon && linux ? join(process.env.XDG_RUNTIME_DIR || tmpdir(), `trayjs-${daemon}.sock`) : undefined;
+    // The addon is one per process, so in-process trays always share it
+    const attached = (socket ? Host.attach(`daemon ${socket}`, client, params, () => Host.connect(socket, backend, args))
+      : undefined)
+      ?? (inProcess && linux && backend !== 'appindicator'
+      ? Host.attach('addon', client, params, () => Host.startAddon(args)) : undefined)
+      ?? Host.attach(shared && linux ? `helper ${backend ?? 'appindicator'}` : undefined, client, params,
+                     () => Host.spawn(backend, args))!;
+    [this.#host, this.#id] = attached;
+    if (daemon && linux && tooltip) this.setTooltip(tooltip);
+  }
+
+  #closed(code: number | null): void {
+    this.#isClosed = true;
+    for (const port of this.#ports) port.close();
+    this.#ports.clear();
+    this.emit('close', code);
+  }
 
-    this.#rl = createInterface({ input: this.#proc.stdout! });
-    this.#rl.on('line', (line: string) => this.#handle(JSON.parse(line)));
-    this.#proc.on('close', (code: number | null) => this.emit('close', code));
+  #enqueue(op: () => void): void {
+    if (this.#menuEncode) this.#queued.push(op);
+    else op();
   }
 
-  #send(msg: Record<string, unknown>): void {
-    this.#proc.stdin!.write(JSON.stringify(msg) + '\n');
+  #send(line: string): void {
+    this.#enqueue(() => this.#host.write([line], this.#id));
+  }
+
+  #flushQueued(): void {
+    for (const op of this.#queued.splice(0)) op();
+  }
+
+  #sendIcon(icon: Icon, attention: boolean, svg = this.#svg): void {
+    this.#shownIcons[attention ? 1 : 0] = icon;
+    const addon = this.#host.addon;
+    // The addon takes PNG bytes as they are; SVG still goes as text
+    if (addon && !(icon.svg && svg)) {
+      const png = readFileSync(icon.png);
+      this.#enqueue(() => addon.setIcon(png, attention, this.#id));
+      return;
+    }
+    const params = iconParams(icon, svg);
+    this.#send(attention ? encode.setAttentionIcon(params) : encode.setIcon(params));
   }
 
-  async #handle(msg: { method: string; params?: Record<string, unknown> }): Promise<void> {
+  // Items go in pre-encoded so cached subtree JSON is spliced in unchanged
+  #sendMenu(items: readonly MenuItem[], requestId?: number): void {
+    if (this.#menuSliceMs === undefined) {
+      this.#send(encode.setMenu({ items: menuToJson(items)[0], requestId }));
+      return;
+    }
+    // A newer menu replaces one still being encoded; lines sent in between
+    // go out first, in order
+    if (this.#menuEncode) {
+      this.#menuEncode.canceled = true;
+      this.#flushQueued();
+    }
+    const job = { canceled: false };
+    this.#menuEncode = job;
+    menuJsonChunks(items, this.#menuSliceMs, job).then(chunks => {
+      if (job.canceled) return;
+      this.#menuEncode = null;
+      // The chunks are written as they are, between the line's head and tail
+      const [head, tail] = encode.setMenu({ items: '\0', requestId }).split('\0');
+      this.#host.write([head, ...chunks, tail], this.#id);
+      this.#flushQueued();
+    }, err => {
+      if (job.canceled) return;
+      this.#menuEncode = null;
+      this.#flushQueued();
+      this.emit('error', err);
+    });
+  }
+
+  async #handle(msg: Event): Promise<void> {
     switch (msg.method) {
       case 'ready':
+        if (msg.params.protocol != null && msg.params.protocol !== PROTOCOL_VERSION)
+          process.emitWarning(`@trayjs/trayjs: helper speaks protocol ${msg.params.protocol}, expected ${PROTOCOL_VERSION}`);
+        this.#svg = msg.params.svg !== false;
         if (this.#pendingIcon) {
           this.setIcon(this.#pendingIcon);
           this.#pendingIcon = null;
         }
+        if (this.#pendingAttentionIcon) {
+          this.setAttentionIcon(this.#pendingAttentionIcon);
+          this.#pendingAttentionIcon = null;
+        }
         this.emit('ready');
         break;
       case 'menuRequested':
-        await this.#refreshMenu();
+        await this.#refreshMenu(msg.params.requestId ?? undefined);
         break;
       case 'clicked':
-        this.#clickedCb?.((msg.params as { id: string }).id);
+        this.#clickedCb?.(msg.params.id);
+        break;
+      case 'scrolled':
+        this.#scrolledCb?.(msg.params);
+        this.emit('scrolled', msg.params);
+        break;
+      case 'iconFailed': {
+        // Lines are handled in order, so this is the newest SVG icon unless
+        // another one followed; resending that one as PNG is still correct
+        const icon = this.#shownIcons[msg.params.attention ? 1 : 0];
+        if (icon?.svg) this.#sendIcon(icon, msg.params.attention, false);
         break;
+      }
+      case 'stats':
+        this.emit('stats', msg.params);
+        break;
+    }
+  }
+
+  #refreshMenu(requestId?: number): Promise<void> {
+    if (!this.#menuRequestedCb) return Promise.resolve();
+    if (this.#menuRun) {
+      // Supersede the running provider; its result is dropped
+      this.#menuAbort?.abort();
+      this.#menuRerun = { requestId };
+      return this.#menuRun;
     }
+    this.#menuRun = this.#runMenuProvider(requestId).finally(() => { this.#menuRun = null; });
+    return this.#menuRun;
   }
 
-  async #refreshMenu(): Promise<void> {
-    if (!this.#menuRequestedCb) return;
-    const items = await this.#menuRequestedCb();
-    this.#send({ method: 'setMenu', params: { items } });
+  async #runMenuProvider(requestId?: number): Promise<void> {
+    for (;;) {
+      const controller = new AbortController();
+      this.#menuAbort = controller;
+      this.#menuRequestId = requestId;
+      try {
+        let key = this.#menuKeyCb?.();
+        if (key !== undefined && key === this.#appliedMenuKey) {
+          this.#send(encode.keepMenu({ requestId }));
+        } else {
+          const result = await this.#menuRequestedCb!(controller.signal);
+          const items = Array.isArray(result) ? result : result.items;
+          if (!Array.isArray(result)) key = result.key;
+          // A superseded run stays silent; the rerun answers the request
+          if (!controller.signal.aborted) {
+            if (key !== undefined && key === this.#appliedMenuKey) {
+              this.#send(encode.keepMenu({ requestId }));
+            } else {
+              this.#sendMenu(items, requestId);
+              this.#appliedMenuKey = key;
+            }
+          }
+        }
+      } catch (err) {
+        if (!controller.signal.aborted) throw err;
+      } finally {
+        this.#menuAbort = null;
+      }
+      if (!this.#menuRerun) return;
+      ({ requestId } = this.#menuRerun);
+      this.#menuRerun = null;
+    }
   }
 
   setIcon(icon: Icon): void {
-    const buf = resolveIcon(icon);
-    this.#send({
-      method: 'setIcon',
-      params: { base64: buf.toString('base64') },
-    });
+    this.#sendIcon(icon, false);
+  }
+
+  /** Preloads the icon shown while the status is `'attention'`. */
+  setAttentionIcon(icon: Icon): void {
+    this.#sendIcon(icon, true);
+  }
+
+  setStatus(status: TrayStatus): void {
+    this.#send(encode.setStatus({ status }));
+  }
+
+  setIconFile(path: string, { watch = false }: { watch?: boolean } = {}): void {
+    this.#send(encode.setIconFile({ path: resolve(path), watch }));
+  }
+
+  setVectorIcon(commands: DrawCommand[] | string): void {
+    const vector = typeof commands === 'string' ? commands : encodeDrawCommands(commands);
+    this.#send(encode.setIcon({ vector }));
+  }
+
+  setSparkline(options: SparklineOptions = {}): void {
+    this.#send(encode.setSparkline(options));
+  }
+
+  pushSample(value: number): void {
+    this.#send(encode.pushSample({ v: value }));
   }
 
   setMenu(items: MenuItem[]): void {
-    this.#send({ method: 'setMenu', params: { items } });
+    // An explicit menu is newer than whatever a running provider returns,
+    // and it answers the request that provider was working on
+    const requestId = this.#menuAbort ? this.#menuRequestId : undefined;
+    this.#menuAbort?.abort();
+    this.#menuRerun = null;
+    this.#appliedMenuKey = undefined;
+    this.#sendMenu(items, requestId);
+  }
+
+  /**
+   * Shows `text` next to the icon (Linux, on hosts that support labels).
+   * Safe to call at high rates: the helper republishes at most `maxRate`
+   * times per second (default 10), always with the newest text.
+   */
+  setLabel(text: string, { maxRate, guide }: { maxRate?: number; guide?: string } = {}): void {
+    this.#send(encode.setLabel({ text, maxRate, guide }));
+  }
+
+  /**
+   * Lets the helper render a clock, elapsed time or countdown itself (Linux).
+   * Runs until `stopTicker()` or until the same target is set explicitly.
+   */
+  startTicker({ from, to, ...options }: TickerOptions = {}): void {
+    const params: Commands['startTicker'] = { ...options };
+    if (from !== undefined) params.from = +from;
+    if (to !== undefined) params.to = +to;
+    this.#send(encode.startTicker(params));
+  }
+
+  stopTicker(): void {
+    this.#send(encode.stopTicker());
   }
 
   setTooltip(text: string): void {
-    this.#send({ method: 'setTooltip', params: { text } });
+    this.#send(encode.setTooltip({ text }));
+  }
+
+  setBadge(text: string | null): void {
+    this.#send(encode.setBadge({ text }));
+  }
+
+  setProgress(value: number | null): void {
+    this.#send(encode.setProgress({ value }));
+  }
+
+  /**
+   * Returns a port for a `TrayHandle` in a worker thread; transfer it with
+   * `worker.postMessage(port, [port])`. The port does not keep the process
+   * alive and is closed when the tray closes.
+   */
+  createPort(): MessagePort {
+    const { port1, port2 } = new MessageChannel();
+    port1.on('message', ({ lines, menu }: HandleBatch) => {
+      // A worker's menu replaces the shown one like setMenu, minus the request
+      if (menu) this.#appliedMenuKey = undefined;
+      for (const line of lines) this.#send(line);
+    });
+    port1.on('close', () => this.#ports.delete(port1));
+    port1.unref();
+    this.#ports.add(port1);
+    return port2;
+  }
+
+  /**
+   * Resolves with the helper's protocol and backend counters (Linux).
+   * Rejects on other platforms, whose helpers do not answer, and when the
+   * tray closes first.
+   */
+  getStats(): Promise<Record<string, unknown>> {
+    if (process.platform !== 'linux')
+      return Promise.reject(new Error(`@trayjs/trayjs: getStats is not supported on ${process.platform}`));
+    if (this.#isClosed) return Promise.reject(new Error('@trayjs/trayjs: tray is closed'));
+    const stats = new Promise<Record<string, unknown>>((resolve, reject) => {
+      const onStats = (params: Record<string, unknown>): void => {
+        this.off('close', onClose);
+        resolve(params);
+      };
+      const onClose = (): void => {
+        this.off('stats', onStats);
+        reject(new Error('@trayjs/trayjs: tray closed before sending stats'));
+      };
+      this.once('stats', onStats);
+      this.once('close', onClose);
+    });
+    this.#send(encode.getStats());
+    return stats;
   }
 
   quit(): void {
-    this.#proc.stdin!.end();
+    if (this.#menuEncode) this.#menuEncode.canceled = true;
+    this.#menuEncode = null;
+    this.#flushQueued();
+    this.#host.detach(this.#id);
+  }
+
+  /**
+   * Lets go of a `daemon` tray, which stays shown as it is until a later
+   * process takes it over. Same as `quit()` for other trays.
+   */
+  detach(): void {
+    if (this.#menuEncode) this.#menuEncode.canceled = true;
+    this.#menuEncode = null;
+    this.#flushQueued();
+    this.#host.release(this.#id);
+  }
+}
+
+/**
+ * Sends commands to a `Tray` from a worker thread, through a port from
+ * `tray.createPort()`. Lines are encoded on the worker and posted once per
+ * microtask: within a batch the newest value of each property wins and
+ * samples keep their order. Batches from different threads apply in the
+ * order they reach the tray's thread.
+ */
+export class TrayHandle {
+  #port: MessagePort;
+  #batch = new Map<string, string>();
+  #menu = false;
+  #samples = 0;
+
+  constructor(port: MessagePort) {
+    this.#port = port;
+  }
+
+  #queue(key: string, line: string): void {
+    if (!this.#batch.size) queueMicrotask(() => this.#flush());
+    // Re-inserting moves the newest value behind what was queued meanwhile
+    this.#batch.delete(key);
+    this.#batch.set(key, line);
+  }
+
+  #flush(): void {
+    if (!this.#batch.size) return;
+    const batch: HandleBatch = { lines: [...this.#batch.values()], menu: this.#menu };
+    this.#batch.clear();
+    this.#menu = false;
+    this.#port.postMessage(batch);
+  }
+
+  setVectorIcon(commands: DrawCommand[] | string): void {
+    const vector = typeof commands === 'string' ? commands : encodeDrawCommands(commands);
+    this.#queue('setIcon', encode.setIcon({ vector }));
+  }
+
+  pushSample(value: number): void {
+    this.#queue(`pushSample ${this.#samples++}`, encode.pushSample({ v: value }));
+  }
+
+  setMenu(items: MenuItem[]): void {
+    this.#menu = true;
+    this.#queue('setMenu', encode.setMenu({ items: menuToJson(items)[0] }));
+  }
+
+  setLabel(text: string, { maxRate, guide }: { maxRate?: number; guide?: string } = {}): void {
+    this.#queue('setLabel', encode.setLabel({ text, maxRate, guide }));
+  }
+
+  setTooltip(text: string): void {
+    this.#queue('setTooltip', encode.setTooltip({ text }));
+  }
+
+  setStatus(status: TrayStatus): void {
+    this.#queue('setStatus', encode.setStatus({ status }));
+  }
+
+  setBadge(text: string | null): void {
+    this.#queue('setBadge', encode.setBadge({ text }));
+  }
+
+  setProgress(value: number | null): void {
+    this.#queue('setProgress', encode.setProgress({ value }));
+  }
+
+  /** Sends what is batched and closes the port. */
+  close(): void {
+    this.#flush();
+    this.#port.close();
   }
 }
@@ -0,0 +1,214 @@
+// Generated by scripts/gen-protocol.mjs from protocol/protocol.json. Do not edit.
+
+import type { MenuItem, TrayStatus } from './index.js';
+
+export const PROTOCOL_VERSION = 2;
+
+/** Parameters of the commands Node sends to the helper. */
+export interface Commands {
+  /** Replaces the menu; answers menu request `requestId` if given. */
+  setMenu: { items: readonly MenuItem[]; requestId?: number | null };
+  /** Answers menu request `requestId` without changing the menu. */
+  keepMenu: { requestId?: number | null };
+  /** Sets the icon from a vector drawing, SVG source or base64 PNG/ICO. */
+  setIcon: { base64?: string | null; svg?: string | null; vector?: string | null; size?: number | null };
+  /** Preloads the icon shown while the status is attention. */
+  setAttentionIcon: { base64?: string | null; svg?: string | null; vector?: string | null; size?: number | null };
+  /** Sets the item status: passive, active or attention. */
+  setStatus: { status: TrayStatus };
+  /** Sets the tooltip (the item title on Linux). */
+  setTooltip: { text: string };
+  /** Sets the label next to the icon, republished at most `maxRate` times per second. */
+  setLabel: { text: string; maxRate?: number | null; guide?: string | null };
+  /** Starts a helper-driven clock, elapsed time or countdown. */
+  startTicker: { format?: string | null; from?: number | null; to?: number | null; interval?: number | null; target?: 'label' | 'tooltip' | null };
+  /** Stops the ticker. */
+  stopTicker: void;
+  /** Shows a PNG or SVG file as the icon, optionally republishing it when it changes. */
+  setIconFile: { path: string; watch?: boolean | null };
+  /** Switches the icon to a sparkline of the pushed samples. */
+  setSparkline: { samples?: number | null; fps?: number | null; min?: number | null; max?: number | null; color?: string | null };
+  /** Appends a sample to the sparkline. */
+  pushSample: { v: number };
+  /** Draws `text` as a badge over the icon; null removes it. */
+  setBadge: { text?: string | null };
+  /** Draws a progress bar (0..1) over the icon; null removes it. */
+  setProgress: { value?: number | null };
+  /** Requests a stats event. */
+  getStats: void;
+  /** Shows another tray item `id` from this process, or applies the options given to an existing one (a daemon's); answered with its ready event. */
+  createTray: { id: number; tooltip?: string | null; menuDeadline?: number | null; menuWindow?: number | null; scrollWindow?: number | null };
+  /** Removes tray item `id`; answered with its closed event. */
+  destroyTray: { id: number };
+}
+
+/** Parameters of the events the helper sends to Node. */
+export interface Events {
+  /** The item is visible and accepts commands. */
+  ready: { protocol?: number | null; svg?: boolean | null; resumed?: boolean | null; state?: Record<string, string> | null };
+  /** The menu is about to open; answer with setMenu or keepMenu. */
+  menuRequested: { requestId?: number | null };
+  /** A menu item was clicked. */
+  clicked: { id: string };
+  /** Wheel movement over the icon, summed over the scroll window. */
+  scrolled: { dx: number; dy: number; count: number; total: number };
+  /** An SVG icon without a PNG fallback did not render; resend it as PNG. */
+  iconFailed: { attention: boolean };
+  /** Protocol and backend counters, in reply to getStats. */
+  stats: Record<string, unknown>;
+  /** The tray item was removed by destroyTray. */
+  closed: void;
+}
+
+/** Fields next to `method` and `params`. */
+export interface Envelope {
+  /** Tray a command is for or an event comes from; absent for tray 0. */
+  tray?: number;
+}
+
+export type Event = {
+  [M in keyof Events]: { method: M; params: Events[M] } & Envelope;
+}[keyof Events];
+
+/** One encoder per command, each returning a complete protocol line. */
+export const encode = {
+  setMenu(p: { items: string; requestId?: number | null }): string {
+    let s = '';
+    s += ',"items":' + p.items;
+    if (p.requestId != null) s += ',"requestId":' + JSON.stringify(p.requestId);
+    return '{"method":"setMenu","params":{' + s.slice(1) + '}}\n';
+  },
+  keepMenu(p: { requestId?: number | null }): string {
+    let s = '';
+    if (p.requestId != null) s += ',"requestId":' + JSON.stringify(p.requestId);
+    return '{"method":"keepMenu","params":{' + s.slice(1) + '}}\n';
+  },
+  setIcon(p: { base64?: string | null; svg?: string | null; vector?: string | null; size?: number | null }): string {
+    let s = '';
+    if (p.base64 != null) s += ',"base64":' + JSON.stringify(p.base64);
+    if (p.svg != null) s += ',"svg":' + JSON.stringify(p.svg);
+    if (p.vector != null) s += ',"vector":' + JSON.stringify(p.vector);
+    if (p.size != null) s += ',"size":' + JSON.stringify(p.size);
+    return '{"method":"setIcon","params":{' + s.slice(1) + '}}\n';
+  },
+  setAttentionIcon(p: { base64?: string | null; svg?: string | null; vector?: string | null; size?: number | null }): string {
+    let s = '';
+    if (p.base64 != null) s += ',"base64":' + JSON.stringify(p.base64);
+    if (p.svg != null) s += ',"svg":' + JSON.stringify(p.svg);
+    if (p.vector != null) s += ',"vector":' + JSON.stringify(p.vector);
+    if (p.size != null) s += ',"size":' + JSON.stringify(p.size);
+    return '{"method":"setAttentionIcon","params":{' + s.slice(1) + '}}\n';
+  },
+  setStatus(p: { status: TrayStatus }): string {
+    let s = '';
+    s += ',"status":' + JSON.stringify(p.status);
+    return '{"method":"setStatus","params":{' + s.slice(1) + '}}\n';
+  },
+  setTooltip(p: { text: string }): string {
+    let s = '';
+    s += ',"text":' + JSON.stringify(p.text);
+    return '{"method":"setTooltip","params":{' + s.slice(1) + '}}\n';
+  },
+  setLabel(p: { text: string; maxRate?: number | null; guide?: string | null }): string {
+    let s = '';
+    s += ',"text":' + JSON.stringify(p.text);
+    if (p.maxRate != null) s += ',"maxRate":' + JSON.stringify(p.maxRate);
+    if (p.guide != null) s += ',"guide":' + JSON.stringify(p.guide);
+    return '{"method":"setLabel","params":{' + s.slice(1) + '}}\n';
+  },
+  startTicker(p: { format?: string | null; from?: number | null; to?: number | null; interval?: number | null; target?: 'label' | 'tooltip' | null }): string {
+    let s = '';
+    if (p.format != null) s += ',"format":' + JSON.stringify(p.format);
+    if (p.from != null) s += ',"from":' + JSON.stringify(p.from);
+    if (p.to != null) s += ',"to":' + JSON.stringify(p.to);
+    if (p.interval != null) s += ',"interval":' + JSON.stringify(p.interval);
+    if (p.target != null) s += ',"target":' + JSON.stringify(p.target);
+    return '{"method":"startTicker","params":{' + s.slice(1) + '}}\n';
+  },
+  stopTicker: (): string => '{"method":"stopTicker"}\n',
+  setIconFile(p: { path: string; watch?: boolean | null }): string {
+    let s = '';
+    s += ',"path":' + JSON.stringify(p.path);
+    if (p.watch != null) s += ',"watch":' + JSON.stringify(p.watch);
+    return '{"method":"setIconFile","params":{' + s.slice(1) + '}}\n';
+  },
+  setSparkline(p: { samples?: number | null; fps?: number | null; min?: number | null; max?: number | null; color?: string | null }): string {
+    let s = '';
+    if (p.samples != null) s += ',"samples":' + JSON.stringify(p.samples);
+    if (p.fps != null) s += ',"fps":' + JSON.stringify(p.fps);
+    if (p.min != null) s += ',"min":' + JSON.stringify(p.min);
+    if (p.max != null) s += ',"max":' + JSON.stringify(p.max);
+    if (p.color != null) s += ',"color":' + JSON.stringify(p.color);
+    return '{"method":"setSparkline","params":{' + s.slice(1) + '}}\n';
+  },
+  pushSample(p: { v: number }): string {
+    let s = '';
+    s += ',"v":' + JSON.stringify(p.v);
+    return '{"method":"pushSample","params":{' + s.slice(1) + '}}\n';
+  },
+  setBadge(p: { text?: string | null }): string {
+    let s = '';
+    if (p.text != null) s += ',"text":' + JSON.stringify(p.text);
+    return '{"method":"setBadge","params":{' + s.slice(1) + '}}\n';
+  },
+  setProgress(p: { value?: number | null }): string {
+    let s = '';
+    if (p.value != null) s += ',"value":' + JSON.stringify(p.value);
+    return '{"method":"setProgress","params":{' + s.slice(1) + '}}\n';
+  },
+  getStats: (): string => '{"method":"getStats"}\n',
+  createTray(p: { id: number; tooltip?: string | null; menuDeadline?: number | null; menuWindow?: number | null; scrollWindow?: number | null }): string {
+    let s = '';
+    s += ',"id":' + JSON.stringify(p.id);
+    if (p.tooltip != null) s += ',"tooltip":' + JSON.stringify(p.tooltip);
+    if (p.menuDeadline != null) s += ',"menuDeadline":' + JSON.stringify(p.menuDeadline);
+    if (p.menuWindow != null) s += ',"menuWindow":' + JSON.stringify(p.menuWindow);
+    if (p.scrollWindow != null) s += ',"scrollWindow":' + JSON.stringify(p.scrollWindow);
+    return '{"method":"createTray","params":{' + s.slice(1) + '}}\n';
+  },
+  destroyTray(p: { id: number }): string {
+    let s = '';
+    s += ',"id":' + JSON.stringify(p.id);
+    return '{"method":"destroyTray","params":{' + s.slice(1) + '}}\n';
+  },
+};
+
+/** Adds envelope fields to a line from `encode`. */
+export function withEnvelope(line: string, env: Envelope): string {
+  let s = '';
+  if (env.tray != null) s += '"tray":' + JSON.stringify(env.tray) + ',';
+  return s ? '{' + s + line.slice(1) : line;
+}
+
+/** The state slot each command line replaces. */
+export const STATE_SLOTS: { readonly [M in keyof Commands]?: string } = {
+  setMenu: 'menu',
+  setIcon: 'icon',
+  setAttentionIcon: 'attentionIcon',
+  setStatus: 'status',
+  setTooltip: 'title',
+  setLabel: 'label',
+  startTicker: 'ticker',
+  stopTicker: 'ticker',
+  setIconFile: 'icon',
+  setSparkline: 'icon',
+  setBadge: 'badge',
+  setProgress: 'progress',
+};
+
+/** Digest of a line from `encode`, as daemons report it in `ready`. */
+export function lineDigest(line: string): string {
+  let h = 0x811c9dc5;
+  for (const b of Buffer.from(line.endsWith('\n') ? line.slice(0, -1) : line))
+    h = Math.imul(h ^ b, 0x01000193);
+  return (h >>> 0).toString(16).padStart(8, '0');
+}
+
+const EVENTS = new Set<string>(['ready', 'menuRequested', 'clicked', 'scrolled', 'iconFailed', 'stats', 'closed']);
+
+/** Parses a helper line; undefined for events this version does not know. */
+export function decodeEvent(line: string): Event | undefined {
+  const msg = JSON.parse(line);
+  if (!msg || typeof msg.method !== 'string' || !EVENTS.has(msg.method)) return undefined;
+  return { method: msg.method, params: msg.params ?? {}, tray: msg.tray ?? undefined } as Event;
+}